@@ -0,0 +1,101 @@
+#version 430 core
+// Мех одним проходом: рисуется только внешняя оболочка, а шейдер идет лучом внутрь через те же
+// слои плотности, что и fur_shader.frag. Поверхность под пикселем считается плоской, поэтому
+// на силуэте картинка отличается от настоящих слоев
+layout (early_fragment_tests) in;
+
+const int MAX_SHELL_LAYERS = 256;   // MAX_SHELL_LAYERS в RenderTypes.hxx
+// Почти касательный луч прошел бы под оболочкой слишком далеко, путь ограничивается
+const float MIN_DESCENT = 0.25;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform vec3 lightPos;
+uniform vec3 viewPos;
+uniform vec3 cameraPos;           // откуда идет луч, viewPos задает только блик
+uniform vec3 lightColor;
+uniform vec3 objectColor;
+uniform float shellHeight;        // высота оболочки, выше нее меха нет
+uniform float marchLength;        // длина меха в мировых координатах
+uniform sampler2D furTextures[5];
+#ifdef FUR_VOLUME
+uniform sampler3D furVolume;      // объемный мех, как в fur_shader.frag
+const float FUR_VOLUME_TILING = 4.0;
+#endif
+#ifdef FUR_HEIGHTS
+uniform sampler2D furHeights;      // высоты волосков, как в fur_shader.frag
+const float FUR_HEIGHT_RAMP = 0.4;
+#endif
+uniform int marchSteps;           // слои ниже оболочки, начиная с основы
+uniform vec2 marchLayers[MAX_SHELL_LAYERS]; // высота слоя и сколько равномерных слоев он представляет
+
+void main()
+{
+    vec3 norm = normalize(Normal);
+    vec3 ray = normalize(FragPos - cameraPos);
+
+    // Касательный базис из производных: градиенты текстурных координат в мировых координатах
+    vec3 dp1 = dFdx(FragPos);
+    vec3 dp2 = dFdy(FragPos);
+    vec2 duv1 = dFdx(TexCoord);
+    vec2 duv2 = dFdy(TexCoord);
+    vec3 dp2perp = cross(dp2, norm);
+    vec3 dp1perp = cross(norm, dp1);
+    float det = dot(dp1, dp2perp);
+    vec2 uvPerDistance = vec2(0.0);
+    if (abs(det) > 1e-12)
+    {
+        vec3 gradU = (dp2perp * duv1.x + dp1perp * duv2.x) / det;
+        vec3 gradV = (dp2perp * duv1.y + dp1perp * duv2.y) / det;
+        uvPerDistance = vec2(dot(ray, gradU), dot(ray, gradV));
+    }
+
+    // Задняя сторона оболочки: луч выходит из меха
+    float descent = -dot(ray, norm);
+    if (descent <= 0.0)
+        discard;
+    descent = max(descent, MIN_DESCENT);
+
+    vec4 sum = vec4(0.0);
+    for (int i = marchSteps - 1; i >= 1 && sum.a < 0.99; --i)
+    {
+        // Точка, где луч опускается до высоты слоя
+        float height = marchLayers[i].x;
+        float t = (shellHeight - height) * marchLength / descent;
+        vec2 uv = TexCoord + uvPerDistance * t;
+
+#ifdef FUR_VOLUME
+        vec3 gx = vec3(duv1 * FUR_VOLUME_TILING, 0.0);
+        vec3 gy = vec3(duv2 * FUR_VOLUME_TILING, 0.0);
+        float alpha = textureGrad(furVolume, vec3(uv * FUR_VOLUME_TILING, height), gx, gy).r;
+#elif defined(FUR_HEIGHTS)
+        float alpha = clamp((textureGrad(furHeights, uv, duv1, duv2).r - height) / FUR_HEIGHT_RAMP, 0.0, 1.0);
+#else
+        int texIndex = clamp(int(height * 5.0), 0, 4);
+        float alpha = textureGrad(furTextures[texIndex], uv, duv1, duv2).r;
+#endif
+        alpha *= 1.0 - height * 0.5;
+        if (alpha < 0.1)
+            continue;
+        alpha = 1.0 - pow(1.0 - alpha, marchLayers[i].y);
+
+        // Освещение (Phong модель) в точке слоя
+        vec3 pos = FragPos + ray * t;
+        vec3 lightDir = normalize(lightPos - pos);
+        vec3 diffuse = max(dot(norm, lightDir), 0.0) * lightColor;
+        vec3 viewDir = normalize(viewPos - pos);
+        vec3 reflectDir = reflect(-lightDir, norm);
+        vec3 specular = pow(max(dot(viewDir, reflectDir), 0.0), 32.0) * lightColor;
+        vec3 color = (diffuse + specular) * objectColor * height;
+
+        // Спереди назад: каждый следующий слой виден сквозь уже набранные
+        sum += (1.0 - sum.a) * vec4(color * alpha, alpha);
+    }
+    if (sum.a < 1.0 / 255.0)
+        discard;
+    FragColor = vec4(sum.rgb / sum.a, sum.a);
+}
@@ -1,19 +1,137 @@
 #version 430 core
+#ifdef ALPHA_TO_COVERAGE
+// Слои непрозрачны и пишут глубину, альфа задает долю покрытых сэмплов MSAA.
+// Без discard ранний тест глубины работает и так
+#define REJECT alpha = 0.0
+#elif defined(STENCIL_CULL)
+// Трафарет считает слои, на которых в пикселе еще есть мех. Отброшенный фрагмент не должен его
+// менять, поэтому ранние тесты здесь не включаются принудительно
+#define REJECT discard
+#else
+// Слои не пишут глубину, поэтому тест глубины можно делать до шейдера, несмотря на discard
+layout (early_fragment_tests) in;
+#define REJECT discard
+#endif
+
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
 
 out vec4 FragColor;
+#ifdef TEMPORAL
+in vec4 CurrentClip;
+in vec4 PreviousClip;
+// Смещение в текстурных координатах относительно предыдущего кадра
+layout (location = 1) out vec4 Velocity;
+#endif
+#ifdef OIT
+// Порядконезависимая прозрачность: FragColor копит взвешенный цвет, здесь произведение прозрачностей
+layout (location = 1) out vec4 Revealage;
+// Слои почти на одной глубине, поэтому вес еще растет к внешним слоям, которые при сортировке лежат сверху
+const float OIT_SHELL_SHARPNESS = 16.0;
+#endif
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform vec3 lightColor;
 uniform vec3 objectColor;
 uniform float shellHeight;
+uniform bool isBaseLayer;         // слой 0, основа объекта
 uniform sampler2D furTextures[5]; // Массив из 5 текстур
+#ifdef FUR_VOLUME
+// Мех запечен в объемную текстуру: высота слоя - третья координата, срезы фильтруются трилинейно
+uniform sampler3D furVolume;
+const float FUR_VOLUME_TILING = 4.0;  // FUR_VOLUME_TILING в FurRenderer.hxx
+#endif
+#ifdef FUR_HEIGHTS
+// Одна текстура высот волосков: слой видит волосок, пока он выше слоя
+uniform sampler2D furHeights;
+const float FUR_HEIGHT_RAMP = 0.4;    // FUR_HEIGHT_RAMP в FurRenderer.hxx
+#endif
+uniform float shellAlphaPower;    // сколько равномерных слоев меха представляет один нарисованный слой
+uniform float lodFade;            // доля пикселей с более детальным уровнем LOD, 1 - переход не идет
+uniform float lodCoarsePower;     // то же, что shellAlphaPower, для грубого уровня: слой заменяет вдвое больше слоев
+uniform bool lodFineOnly;         // слой есть только в более детальном уровне
+#ifdef EMPTY_TILES
+// Уровень mip для проверки пустых тайлов: блоки 4x4 текселя (EMPTY_TILE_LEVEL в FurRenderer.hxx)
+const float EMPTY_TILE_LEVEL = 2.0;
+uniform bool emptyTiles;          // у текстуры слоя достаточно пустых тайлов, чтобы проверка окупалась
+// Максимумы текстуры текущего слоя по блокам (с каймой в тексель). Отдельный сэмплер, а не индекс
+// в массиве: выборка из массива по индексу дорогая. На плотных текстурах даже невыполняемая
+// ветка стоит времени, поэтому проверка есть только в этом варианте
+uniform sampler2D tileCeiling;
+#endif
+#ifdef STENCIL_CULL
+uniform sampler2D furCeilings[5]; // максимумы текстур меха по блокам в уровнях mip
+// Запас в уровнях mip на смещение слоев относительно пикселя: блок в 8 раз больше пикселя
+const float CEILING_MARGIN_LEVELS = 3.0;
+#endif
+
+// Упорядоченный дизеринг 4x4 для плавного перехода между уровнями LOD
+float bayer4(vec2 position)
+{
+    ivec2 p = ivec2(position) & 3;
+    const float pattern[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                        3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    return (pattern[p.y * 4 + p.x] + 0.5) / 16.0;
+}
 
 void main()
 {
+#ifdef DEPTH_ONLY
+    // Предварительный проход глубины: цвет не записывается
+    return;
+#endif
+#ifdef TEMPORAL
+    Velocity = vec4((CurrentClip.xy / CurrentClip.w - PreviousClip.xy / PreviousClip.w) * 0.5, 0.0, 1.0);
+#endif
+
+    // Основа непрозрачна. Признак слоя, а не его высота: при корневом распределении нижние слои
+    // меха тоже почти на нуле
+    if (isBaseLayer)
+    {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+	return;
+    } 
+
+    // Выбираем текстуру в зависимости от высоты слоя
+    int texIndex = int(shellHeight * 5.0);
+    texIndex = clamp(texIndex, 0, 4);
+    // Дополнительное уменьшение прозрачности для верхних слоев
+    float fade = 1.0 - shellHeight * 0.5;
+
+#ifdef EMPTY_TILES
+    // Пустой грубый тайл: во всем блоке текстуры нет меха выше порога, дальше можно не считать
+    if (emptyTiles && textureLod(tileCeiling, TexCoord, EMPTY_TILE_LEVEL).r * fade < 0.1)
+        REJECT;
+#endif
+
+#ifdef FUR_VOLUME
+    float alpha = texture(furVolume, vec3(TexCoord * FUR_VOLUME_TILING, shellHeight)).r;
+#elif defined(FUR_HEIGHTS)
+    // Непрозрачность растет с высотой волоска над слоем, выше вершины она 0
+    float alpha = clamp((texture(furHeights, TexCoord).r - shellHeight) / FUR_HEIGHT_RAMP, 0.0, 1.0);
+#else
+    float alpha = texture(furTextures[texIndex], TexCoord).r;
+#endif
+    alpha *= fade;
+
+#ifdef STENCIL_CULL
+    // Пиксель без меха, но в его окрестности мех еще есть: фрагмент ничего не рисует, но остается
+    // живым для трафарета. Только если и максимум окрестности ниже порога, мех здесь кончился
+    if (alpha < 0.1)
+    {
+        float lod = textureQueryLod(furTextures[texIndex], TexCoord).y + CEILING_MARGIN_LEVELS;
+        float ceiling = textureLod(furCeilings[texIndex], TexCoord, lod).r * fade;
+        if (ceiling < 0.1)
+            discard;
+        FragColor = vec4(0.0);
+        return;
+    }
+#endif
+    if (alpha < 0.1)
+        REJECT;
+
     // Освещение (Phong модель)
     vec3 norm = normalize(Normal);
     vec3 lightDir = normalize(lightPos - FragPos);
@@ -28,25 +146,31 @@ void main()
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
     vec3 specular = spec * lightColor;
     
-    // Выбираем текстуру в зависимости от высоты слоя
-    int texIndex = int(shellHeight * 5.0);
-    texIndex = clamp(texIndex, 0, 4);
-    
-    float alpha = texture(furTextures[texIndex], TexCoord).r;
-    
-    // Дополнительное уменьшение прозрачности для верхних слоев
-    alpha *= (1.0 - shellHeight * 0.5);
-
-    if (shellHeight < 0.001)
+    // Во время перехода часть пикселей рисуется грубым уровнем: без его лишних слоев, каждый слой плотнее
+    float alphaPower = shellAlphaPower;
+    if (lodFade < 1.0)
     {
-        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
-	return;
-    } 
-    
-    if (alpha < 0.1)
-        discard;
+        bool fine = bayer4(gl_FragCoord.xy) < lodFade;
+        if (lodFineOnly && !fine)
+            REJECT;
+        if (!fine)
+            alphaPower = lodCoarsePower;
+    }
+
+    // Когда рисуется только часть слоев, каждый слой непрозрачнее, как несколько слоев подряд
+    if (alphaPower != 1.0)
+        alpha = 1.0 - pow(1.0 - alpha, alphaPower);
     
     // Финальный цвет
     vec3 result = (diffuse + specular) * objectColor * shellHeight;
+#ifdef OIT
+    // Вес по глубине из weighted blended OIT (McGuire, Bavoil 2013): ближние слои важнее,
+    // внешний слой весит в 2^16 раз больше основы
+    float z = 1.0 / gl_FragCoord.w;
+    float weight = alpha * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) + pow(z / 200.0, 6.0)), 1e-2, 3e3) * exp2((shellHeight - 1.0) * OIT_SHELL_SHARPNESS);
+    FragColor = vec4(result * alpha, alpha) * weight;
+    Revealage = vec4(alpha);
+#else
     FragColor = vec4(result, alpha);
+#endif
 }
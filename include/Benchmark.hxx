@@ -0,0 +1,267 @@
+#ifndef _BENCHMARK_HXX_
+#define _BENCHMARK_HXX_
+
+#include <glad/glad.h>
+
+#include <Profiler.hxx>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct FrameTimeStats {
+    int count = 0;
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+// nearest-rank percentiles of the samples (milliseconds).
+inline FrameTimeStats computeFrameTimeStats(std::vector<double> samples)
+{
+    FrameTimeStats stats;
+    if (samples.empty())
+        return stats;
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+        return samples[std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0)];
+    };
+    double sum = 0.0;
+    for (double s : samples)
+        sum += s;
+    stats.count = (int)samples.size();
+    stats.mean = sum / samples.size();
+    stats.p50 = percentile(50.0);
+    stats.p95 = percentile(95.0);
+    stats.p99 = percentile(99.0);
+    stats.min = samples.front();
+    stats.max = samples.back();
+    return stats;
+}
+
+// everything that identifies a benchmark run besides the timings.
+struct BenchmarkInfo {
+    std::string mode;           // "windowed" or "headless".
+    std::string renderer;
+    std::string version;
+    int width = 0;
+    int height = 0;
+    int shellLayers = 0;
+    std::string shellSpacing;
+    float furLength = 0.0f;
+    std::string furData;
+    std::string sphereGeometry;
+    int textureCount = 0;
+    int textureSize = 0;
+    std::vector<int> textureSizes;  // per texture, empty ones are stored as one texel.
+    std::vector<float> dotSizes;
+    float furScale = 1.0f;
+    int shellSubset = 0;
+    bool shellLod = true;
+    bool layerCutoff = true;
+    bool oit = false;
+    bool alphaToCoverage = false;
+    bool stencilCull = false;
+    bool shellCache = false;
+    bool staticScene = false;
+    bool rayMarch = false;
+    float rayMarchDistance = 0.0f;
+    int objects = 1;
+    int shellBudget = 0;
+    float mipBias = 0.0f;
+};
+
+// records CPU submission time, GPU time and frame interval of every frame after a short warm-up.
+class Benchmark
+{
+public:
+    static const int WARMUP_FRAMES = 10;
+
+    Benchmark() : enabled(false), frameIndex(0) {}
+
+    void init()
+    {
+        enabled = true;
+        gpuTimer.init(true);
+        start = Clock::now();
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    void beginFrame()
+    {
+        if (!enabled)
+            return;
+        Clock::time_point now = Clock::now();
+        if (frameIndex > 0)
+            frameMs.push_back(msBetween(frameStart, now));
+        frameStart = now;
+        gpuTimer.begin();
+    }
+
+    void endFrame()
+    {
+        if (!enabled)
+            return;
+        gpuTimer.end();
+        cpuMs.push_back(msBetween(frameStart, Clock::now()));
+        ++frameIndex;
+    }
+
+    // collect the outstanding GPU results and write the report, returns false if the file can't be written.
+    bool finish(const BenchmarkInfo& info, const std::string& path)
+    {
+        if (!enabled)
+            return true;
+        gpuTimer.flush();
+        double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        FrameTimeStats cpu = computeFrameTimeStats(withoutWarmup(cpuMs, WARMUP_FRAMES));
+        FrameTimeStats gpu = computeFrameTimeStats(withoutWarmup(gpuTimer.samples(), WARMUP_FRAMES));
+        // frame intervals start at the second frame.
+        FrameTimeStats frame = computeFrameTimeStats(withoutWarmup(frameMs, WARMUP_FRAMES - 1));
+
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << std::fixed << std::setprecision(3)
+                  << "benchmark: " << frameIndex << " frames (" << WARMUP_FRAMES << " warm-up) at "
+                  << info.width << "x" << info.height << ", " << totalSeconds << " s" << std::endl;
+        printStats("cpu", cpu);
+        printStats("gpu", gpu);
+        printStats("frame", frame);
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::BENCHMARK:: can't write " << path << std::endl;
+            return false;
+        }
+        file << std::fixed << std::setprecision(4);
+        file << "{\n"
+             << "  \"mode\": " << jsonString(info.mode) << ",\n"
+             << "  \"renderer\": " << jsonString(info.renderer) << ",\n"
+             << "  \"gl_version\": " << jsonString(info.version) << ",\n"
+             << "  \"frames\": " << frameIndex << ",\n"
+             << "  \"warmup_frames\": " << WARMUP_FRAMES << ",\n"
+             << "  \"time_step\": \"fixed\",\n"
+             << "  \"vsync\": false,\n"
+             << "  \"resolution\": [" << info.width << ", " << info.height << "],\n"
+             << "  \"shell_layers\": " << info.shellLayers << ",\n"
+             << "  \"shell_spacing\": " << jsonString(info.shellSpacing) << ",\n"
+             << "  \"fur_length\": " << info.furLength << ",\n"
+             << "  \"fur_data\": " << jsonString(info.furData) << ",\n"
+             << "  \"sphere_geometry\": " << jsonString(info.sphereGeometry) << ",\n"
+             << "  \"fur_textures\": { \"count\": " << info.textureCount << ", \"size\": " << info.textureSize
+             << ", \"sizes\": [";
+        for (size_t i = 0; i < info.textureSizes.size(); ++i)
+            file << (i ? ", " : "") << info.textureSizes[i];
+        file << "], \"format\": \"R8\", \"dot_sizes\": [";
+        for (size_t i = 0; i < info.dotSizes.size(); ++i)
+            file << (i ? ", " : "") << std::setprecision(6) << info.dotSizes[i];
+        file << std::setprecision(4) << "] },\n"
+             << "  \"fur_scale\": " << info.furScale << ",\n"
+             << "  \"shell_subset\": " << info.shellSubset << ",\n"
+             << "  \"shell_lod\": " << (info.shellLod ? "true" : "false") << ",\n"
+             << "  \"layer_cutoff\": " << (info.layerCutoff ? "true" : "false") << ",\n"
+             << "  \"oit\": " << (info.oit ? "true" : "false") << ",\n"
+             << "  \"alpha_to_coverage\": " << (info.alphaToCoverage ? "true" : "false") << ",\n"
+             << "  \"stencil_cull\": " << (info.stencilCull ? "true" : "false") << ",\n"
+             << "  \"shell_cache\": " << (info.shellCache ? "true" : "false") << ",\n"
+             << "  \"static_scene\": " << (info.staticScene ? "true" : "false") << ",\n"
+             << "  \"ray_march\": " << (info.rayMarch ? "true" : "false") << ",\n"
+             << "  \"ray_march_distance\": " << info.rayMarchDistance << ",\n"
+             << "  \"objects\": " << info.objects << ",\n"
+             << "  \"shell_budget\": " << info.shellBudget << ",\n"
+             << "  \"mip_bias\": " << info.mipBias << ",\n"
+             << "  \"total_seconds\": " << totalSeconds << ",\n";
+        writeStats(file, "cpu_ms", cpu, false);
+        writeStats(file, "gpu_ms", gpu, false);
+        writeStats(file, "frame_ms", frame, true);
+        file << "}\n";
+        std::cout << "benchmark: wrote " << path << std::endl;
+        return true;
+    }
+
+    void release()
+    {
+        if (enabled)
+            gpuTimer.release();
+        enabled = false;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    bool enabled;
+    int frameIndex;
+    Clock::time_point start;
+    Clock::time_point frameStart;
+    GpuFrameTimer gpuTimer;
+    std::vector<double> cpuMs;
+    std::vector<double> frameMs;
+
+    static double msBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    static std::vector<double> withoutWarmup(const std::vector<double>& samples, int warmup)
+    {
+        if ((int)samples.size() <= warmup)
+            return samples;
+        return std::vector<double>(samples.begin() + warmup, samples.end());
+    }
+
+    // text as a quoted JSON string, driver strings may hold quotes, backslashes or control characters.
+    static std::string jsonString(const std::string& text)
+    {
+        std::string out = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+                out += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+                out += escaped;
+            }
+            else
+                out += c;
+        }
+        return out + "\"";
+    }
+
+    static void printStats(const char* name, const FrameTimeStats& s)
+    {
+        std::cout << "  " << std::left << std::setw(6) << name << std::right
+                  << " mean " << std::setw(8) << s.mean << "  p50 " << std::setw(8) << s.p50
+                  << "  p95 " << std::setw(8) << s.p95 << "  p99 " << std::setw(8) << s.p99 << " ms" << std::endl;
+    }
+
+    static void writeStats(std::ofstream& file, const char* name, const FrameTimeStats& s, bool last)
+    {
+        file << "  \"" << name << "\": { \"samples\": " << s.count << ", \"mean\": " << s.mean
+             << ", \"p50\": " << s.p50 << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+             << ", \"min\": " << s.min << ", \"max\": " << s.max << " }" << (last ? "\n" : ",\n");
+    }
+};
+#endif
@@ -100,6 +100,15 @@ public:
         updateCameraVectors();
     }
 
+    // turns the camera towards target, used by scripted camera paths.
+    void LookAt(glm::vec3 target)
+    {
+        glm::vec3 direction = glm::normalize(target - Position);
+        Pitch = glm::degrees(asin(direction.y));
+        Yaw = glm::degrees(atan2(direction.z, direction.x));
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
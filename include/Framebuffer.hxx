@@ -0,0 +1,130 @@
+#ifndef _FRAMEBUFFER_HXX_
+#define _FRAMEBUFFER_HXX_
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// offscreen render target: one color texture and a sampleable depth/stencil texture.
+// With format GL_NONE only the depth/stencil texture is created, auxFormat adds a second color
+// attachment (e.g. motion vectors). With sampleCount > 0 all attachments are multisample textures,
+// those can't be filtered and are resolved with a blit.
+class Framebuffer
+{
+public:
+    GLuint FBO;
+    GLuint colorTexture;
+    GLuint auxTexture;
+    GLuint depthTexture;
+    int width;
+    int height;
+
+    int samples;
+
+    Framebuffer() : FBO(0), colorTexture(0), auxTexture(0), depthTexture(0), width(0), height(0), samples(0),
+                    colorFormat(GL_RGBA8), auxFormat(GL_NONE) {}
+
+    // returns false if the framebuffer is incomplete.
+    bool create(int w, int h, GLenum format = GL_RGBA8, GLenum secondFormat = GL_NONE, int sampleCount = 0)
+    {
+        release();
+        width = w;
+        height = h;
+        samples = sampleCount;
+        colorFormat = format;
+        auxFormat = format != GL_NONE ? secondFormat : GL_NONE;
+
+        if (colorFormat != GL_NONE)
+            colorTexture = allocate(colorFormat, GL_LINEAR);
+        if (auxFormat != GL_NONE)
+            auxTexture = allocate(auxFormat, GL_NEAREST);
+        depthTexture = allocate(GL_DEPTH24_STENCIL8, GL_NEAREST);
+        glBindTexture(textureTarget(), 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        if (colorTexture)
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureTarget(), colorTexture, 0);
+        if (auxTexture)
+        {
+            static const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, textureTarget(), auxTexture, 0);
+            glDrawBuffers(2, drawBuffers);
+        }
+        if (!colorTexture)
+        {
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, textureTarget(), depthTexture, 0);
+        GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (status != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "ERROR::FRAMEBUFFER:: incomplete framebuffer 0x" << std::hex << status << std::dec << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // recreate the attachments if the size changed.
+    bool resize(int w, int h)
+    {
+        if (FBO && w == width && h == height)
+            return true;
+        return create(w, h, colorFormat, auxFormat, samples);
+    }
+
+    void bind()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    void release()
+    {
+        if (FBO)
+            glDeleteFramebuffers(1, &FBO);
+        if (colorTexture)
+            glDeleteTextures(1, &colorTexture);
+        if (auxTexture)
+            glDeleteTextures(1, &auxTexture);
+        if (depthTexture)
+            glDeleteTextures(1, &depthTexture);
+        FBO = colorTexture = auxTexture = depthTexture = 0;
+    }
+
+private:
+    GLenum colorFormat;
+    GLenum auxFormat;
+
+    GLenum textureTarget() const
+    {
+        return samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    }
+
+    // storage for one attachment, left bound to textureTarget().
+    GLuint allocate(GLenum internalFormat, GLint filter)
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(textureTarget(), texture);
+        if (samples > 0)
+            glTexStorage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, samples, internalFormat, width, height, GL_TRUE);
+        else
+        {
+            glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+            setSampling(filter);
+        }
+        return texture;
+    }
+
+    static void setSampling(GLint filter)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+};
+#endif
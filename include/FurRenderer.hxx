@@ -0,0 +1,1988 @@
+#ifndef _FUR_RENDERER_HXX_
+#define _FUR_RENDERER_HXX_
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <Shader.hxx>
+#include <GLStateCache.hxx>
+#include <RenderTypes.hxx>
+#include <Simulation.hxx>
+#include <Profiler.hxx>
+#include <Framebuffer.hxx>
+#include <UploadRing.hxx>
+#include <VertexPool.hxx>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// rendering params.
+const int SHELL_LAYERS = 64;    // default shell count, the fur textures' opacity is tuned for that many even shells.
+const float FUR_LENGTH = 0.3f;
+const int SHELL_BATCH = 8;      // shells per profiler scope.
+const int NUM_FUR_TEXTURES = 5;
+const int FUR_TEXTURE_SIZE = 2048;   // largest fur texture, dots are placed as densely as at this size.
+const int FUR_MIN_TEXTURE_SIZE = 64;
+const float FUR_DOT_TEXELS = 2.0f;  // radius in texels the largest dot of a fur texture gets, below that dots lose their fade.
+const int FUR_TEXTURE_BAND = 64;    // rows of a fur texture generated and uploaded at a time.
+// sizes of dots for each of textures.
+const float FUR_DOT_SIZES[NUM_FUR_TEXTURES] = {0.002f, 0.001f, 0.0005f, 0.00025f, 0.000125f};
+// 3D fur: a tile of FUR_VOLUME_SIZE^2 texels repeats FUR_VOLUME_TILING times per texture coordinate
+// unit, so its texels are as fine as the 2D textures'. FUR_VOLUME_DEPTH slices from root to tip.
+const int FUR_VOLUME_SIZE = 512;
+const int FUR_VOLUME_DEPTH = 32;
+const int FUR_VOLUME_TILING = FUR_TEXTURE_SIZE / FUR_VOLUME_SIZE;
+// strand height map: alpha of a strand is its height above the shell over FUR_HEIGHT_RAMP, as in
+// fur_shader.frag. FUR_HEIGHT_SLICES bands of statistics stand in for the textures' for the shell table.
+const float FUR_HEIGHT_RAMP = 0.4f;
+const int FUR_HEIGHT_SLICES = 32;
+// tessellation of the unit sphere the fur grows on.
+const int SPHERE_SECTORS = 36;
+const int SPHERE_STACKS = 18;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 300.0f;
+// resolutions the fur shells can be rendered at, relative to the target.
+const float FUR_SCALES[] = {1.0f, 0.5f, 0.25f};
+const int NUM_FUR_SCALES = 3;
+const int DEFAULT_SHELL_SUBSET = 16;
+const float TAA_FEEDBACK = 0.9f;        // weight of the accumulated history.
+const int TAA_SETTLE_FRAMES = 32;       // frames until a still image has converged.
+// shell LOD: spacing of the shells on screen that still looks like the full stack, and the fewest shells drawn.
+const float LOD_PIXELS_PER_SHELL = 1.0f;
+const int LOD_MIN_SHELLS = 4;
+const float FUR_ALPHA_CUTOFF = 0.1f;     // shell fragments below this alpha are discarded, as in fur_shader.frag.
+const int EMPTY_TILE_LEVEL = 2;         // density pyramid level of the empty tile test in fur_shader.frag.
+const float EMPTY_TILE_MIN_FRACTION = 0.25f;    // below this share of empty tiles the test costs more than it saves.
+const int MSAA_SAMPLES = 4;             // samples of the alpha-to-coverage target.
+const float LOD_FADE_RANGE = 0.5f;      // crossfade while the wanted count is 1 to 1.5 times the coarser level.
+
+// quality switches of the renderer, can be changed between any two frames.
+struct RenderSettings {
+    float furScale = 1.0f;      // below 1 the shells go to a smaller target and are upsampled.
+    int shellSubset = 0;        // shells drawn per frame with temporal accumulation, 0 draws all of them.
+    bool shellLod = true;       // fewer shells for objects whose fur covers few pixels.
+    int shellBudget = 0;        // most shells drawn per object, 0 is no limit.
+    float mipBias = 0.0f;       // above 0 the fur textures are mipmapped with this LOD bias.
+    bool oit = false;           // weighted blended order-independent transparency for full resolution shells.
+    bool alphaToCoverage = false;   // full resolution shells as opaque MSAA geometry, coverage from alpha.
+    bool layerCutoff = true;    // shells above the highest texel that can pass the alpha cutoff aren't drawn.
+    bool stencilCull = false;   // the stencil rejects pixels whose fur ended at a lower shell.
+    bool rayMarch = false;      // every object's fur is ray-marched under one hull instead of drawn as shells.
+    float rayMarchDistance = 0.0f;  // objects at least this far from the camera are ray-marched, 0 is off.
+    bool shellCache = false;    // shells of objects that stay put are drawn from vertices captured once.
+};
+
+// shells of one object in one frame: every stride-th shell. While fade < 1 the shells that only the
+// finer level has (odd multiples of stride) are dithered in on that fraction of the pixels.
+struct ShellLod {
+    int stride = 1;
+    float fade = 1.0f;
+};
+
+// pick the shell LOD from how many pixels the fur of the object spans on screen. focalPixels is
+// the projection's y scale times half the viewport height.
+inline ShellLod computeShellLod(const ObjectState& object, const glm::vec3& cameraPosition, float focalPixels)
+{
+    ShellLod lod;
+    int layers = object.fur.shellLayers;
+    float scale = glm::length(glm::vec3(object.model[0]));
+    float furLength = object.fur.length * scale;
+    float distance = std::max(glm::length(glm::vec3(object.model[3]) - cameraPosition) - scale - furLength, NEAR_PLANE);
+    float wanted = std::max(furLength * focalPixels / distance / LOD_PIXELS_PER_SHELL, (float)LOD_MIN_SHELLS);
+
+    // coarsest power of two stride that still draws at least the wanted shells.
+    while (lod.stride < layers / LOD_MIN_SHELLS && layers / (lod.stride * 2) >= wanted)
+        lod.stride *= 2;
+    float coarse = (float)layers / (lod.stride * 2);
+    if (coarse >= LOD_MIN_SHELLS)
+        lod.fade = glm::clamp((wanted / coarse - 1.0f) / LOD_FADE_RANGE, 0.0f, 1.0f);
+    if (lod.fade <= 0.0f) {
+        lod.stride *= 2;
+        lod.fade = 1.0f;
+    }
+    return lod;
+}
+
+// max-density pyramid of one fur texture, what is culled with it depends only on the fur data.
+struct FurDensity {
+    GLuint ceiling = 0;         // mip levels hold the maximum of the texels below them.
+    float maxValue = 0.0f;      // largest texel.
+    int tileCount = 0;          // texels of level EMPTY_TILE_LEVEL.
+    std::array<int, 257> tilesBelow{};   // [v]: tiles whose maximum is below v / 255.
+    std::array<int, 256> texels{};      // histogram of the fur texture itself.
+
+    // share of tiles without a texel that reaches threshold.
+    float emptyTileFraction(float threshold) const
+    {
+        int v = std::min(256, (int)std::ceil(threshold * 255.0f));
+        return tileCount ? (float)tilesBelow[v] / tileCount : 0.0f;
+    }
+
+    // mean alpha of a shell that fades the texture by fade, texels below the cutoff are discarded.
+    double coverage(float fade) const
+    {
+        double sum = 0.0;
+        int count = 0;
+        for (int v = 0; v < 256; ++v) {
+            count += texels[v];
+            float alpha = v / 255.0f * fade;
+            if (alpha >= FUR_ALPHA_CUTOFF)
+                sum += (double)texels[v] * alpha;
+        }
+        return count ? sum / count : 0.0;
+    }
+};
+
+// size factor of a dot for a variation in [0, 100), dots of the fur textures vary by -20% to +20%.
+inline float furDotScale(int variation) {
+    return 0.8f + 0.4f * variation / 100.0f;
+}
+
+// resolution of the fur texture with dotSize: the smallest power of two at which its largest dot
+// gets FUR_DOT_TEXELS of radius, so textures of large dots are stored coarser. Dots are drawn with
+// a radius of whole texels; if not even the largest one reaches a texel at FUR_TEXTURE_SIZE the
+// texture is empty and stored as a single black texel that samples the same everywhere.
+inline int furTextureSize(float dotSize) {
+    float largest = dotSize * furDotScale(99);
+    if ((int)(largest * FUR_TEXTURE_SIZE / 2) == 0)
+        return 1;
+    int size = FUR_MIN_TEXTURE_SIZE;
+    while (size < FUR_TEXTURE_SIZE && largest * size / 2 < FUR_DOT_TEXELS)
+        size *= 2;
+    return size;
+}
+
+// one dot of a fur texture.
+struct FurDot {
+    uint16_t x, y;
+    int16_t radius;
+};
+
+// maximum of every 2x2 block of a width x height level (odd sizes repeat the last texel), the
+// next level down of a density pyramid.
+inline void reduceCeilingLevel(const unsigned char* level, int width, int height, unsigned char* next) {
+    int w = std::max(1, width / 2), h = std::max(1, height / 2);
+    for (int y = 0; y < h; ++y)
+        for (int x = 0; x < w; ++x) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            next[y * w + x] = std::max(std::max(level[y0 * width + x0], level[y0 * width + x1]),
+                                       std::max(level[y1 * width + x0], level[y1 * width + x1]));
+        }
+}
+
+// generation of simple fur texture. With density its pyramid is created as well: level 0 is the
+// texture grown by one texel (3x3 maximum, wrapping), so a texel of any level also covers the
+// bilinear footprint of every point in its block.
+// The texture is rasterized in bands of FUR_TEXTURE_BAND rows, each one goes to the GPU through an
+// upload ring while the next is drawn. The pyramid follows band by band down to the level where a
+// band is a single row, the levels below that are reduced from those rows at the end.
+inline GLuint generateFurTexture(int width, int height, float dotSize, FurDensity* density = nullptr) {
+    srand(0);
+    // sizes are powers of two (furTextureSize), so the bands split the texture evenly.
+    const int band = std::min(FUR_TEXTURE_BAND, height);
+    const int bands = height / band;
+
+    // count of dots: as many per texture coordinate unit as at FUR_TEXTURE_SIZE, whatever the
+    // resolution. A single texel is an empty texture (furTextureSize), it gets none.
+    int numDots = width * height > 1 ? FUR_TEXTURE_SIZE * FUR_TEXTURE_SIZE / 10 : 0;
+
+    // dots sorted into the bands they reach, with one more row on each side for the 3x3 maximum.
+    // Every band draws its dots in the order they were placed, as a single pass over the whole
+    // texture would.
+    std::vector<std::vector<FurDot>> bandDots(bands);
+    std::vector<int> lastDot(bands, -1);
+    for (int i = 0; i < numDots; ++i) {
+        int centerX = rand() % width;
+        int centerY = rand() % height;
+        
+        // size of point with some variations.
+        float currentDotSize = dotSize * furDotScale(rand() % 100);
+        int radius = static_cast<int>(currentDotSize * std::min(width, height) / 2);
+
+        FurDot dot = { (uint16_t)centerX, (uint16_t)centerY, (int16_t)radius };
+        for (int y = centerY - radius - 1; y <= centerY + radius + 1; ++y) {
+            int b = ((y % height + height) % height) / band;
+            if (lastDot[b] != i) {
+                bandDots[b].push_back(dot);
+                lastDot[b] = i;
+            }
+        }
+    }
+
+    // levels of the pyramid a band still has whole rows of.
+    int bandLevels = 1;
+    while ((band >> bandLevels) > 0 && (width >> bandLevels) > 0)
+        ++bandLevels;
+    size_t pieceSize = (size_t)band * width;
+    if (density)
+        for (int level = 0; level < bandLevels; ++level)
+            pieceSize += (size_t)(band >> level) * (width >> level);
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+    if (density) {
+        glGenTextures(1, &density->ceiling);
+        glBindTexture(GL_TEXTURE_2D, density->ceiling);
+        for (int level = 0, w = width, h = height; ; ++level, w = std::max(1, w / 2), h = std::max(1, h / 2)) {
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R8, w, h, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
+            if (w == 1 && h == 1)
+                break;
+        }
+    }
+
+    UploadRing ring;
+    ring.init(pieceSize);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // the band with its neighbour rows, and the band's part of every pyramid level.
+    std::vector<unsigned char> rows((size_t)(band + 2) * width);
+    std::vector<std::vector<unsigned char>> levels(bandLevels);
+    for (int level = 0; level < bandLevels; ++level)
+        levels[level].resize((size_t)(band >> level) * (width >> level));
+    // the single row every band leaves of the last band level.
+    int tailWidth = width >> (bandLevels - 1);
+    std::vector<unsigned char> tail((size_t)bands * tailWidth);
+    std::array<int, 256> tileHistogram{};
+
+    for (int b = 0; b < bands; ++b) {
+        int y0 = b * band;
+        std::fill(rows.begin(), rows.end(), 0);
+        for (const FurDot& dot : bandDots[b]) {
+            int radius = dot.radius;
+            // Draw round dot.
+            for (int dy = -radius; dy <= radius; ++dy) {
+                int py = (dot.y + dy + height) % height;
+                // local rows holding py, more than one if the texture is lower than the band.
+                for (int row = (py - y0 + 1 + height) % height; row < band + 2; row += height) {
+                    for (int dx = -radius; dx <= radius; ++dx) {
+                        if (dx*dx + dy*dy <= radius*radius) {
+                            int px = (dot.x + dx + width) % width;
+
+                            // Smooth fade to the edges.
+                            float dist = sqrtf(dx*dx + dy*dy) / radius;
+                            float value = 1.0f - dist * dist;
+
+                            value *= 1.0f - (float)py / height * 0.5f;
+
+                            // mixing with existing values.
+                            unsigned char& texel = rows[(size_t)row * width + px];
+                            float oldValue = texel / 255.0f;
+                            value = std::max(oldValue, value);
+                            texel = static_cast<unsigned char>(value * 255);
+                        }
+                    }
+                }
+            }
+        }
+
+        unsigned char* piece = ring.begin();
+        const unsigned char* texels = &rows[width];
+        std::copy(texels, texels + (size_t)band * width, piece);
+        size_t pieceOffset = (size_t)band * width;
+        if (density) {
+            for (size_t t = 0; t < (size_t)band * width; ++t)
+                ++density->texels[texels[t]];
+            for (int y = 0; y < band; ++y)
+                for (int x = 0; x < width; ++x) {
+                    unsigned char m = 0;
+                    for (int dy = 0; dy <= 2; ++dy)
+                        for (int dx = -1; dx <= 1; ++dx)
+                            m = std::max(m, rows[(size_t)(y + dy) * width + (x + dx + width) % width]);
+                    levels[0][(size_t)y * width + x] = m;
+                }
+            for (int level = 0; level < bandLevels; ++level) {
+                if (level > 0)
+                    reduceCeilingLevel(levels[level - 1].data(), width >> (level - 1), band >> (level - 1), levels[level].data());
+                if (level == EMPTY_TILE_LEVEL)
+                    for (unsigned char v : levels[level])
+                        ++tileHistogram[v];
+                std::copy(levels[level].begin(), levels[level].end(), piece + pieceOffset);
+                pieceOffset += levels[level].size();
+            }
+            std::copy(levels[bandLevels - 1].begin(), levels[bandLevels - 1].end(), tail.begin() + (size_t)b * tailWidth);
+        }
+        ring.end();
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, width, band, GL_RED, GL_UNSIGNED_BYTE, UploadRing::offset(0));
+        if (density) {
+            glBindTexture(GL_TEXTURE_2D, density->ceiling);
+            pieceOffset = (size_t)band * width;
+            for (int level = 0; level < bandLevels; ++level) {
+                glTexSubImage2D(GL_TEXTURE_2D, level, 0, y0 >> level, width >> level, band >> level,
+                                GL_RED, GL_UNSIGNED_BYTE, UploadRing::offset(pieceOffset));
+                pieceOffset += levels[level].size();
+            }
+        }
+    }
+    ring.release();
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // the texture itself samples level 0 only, the mip chain is there for the LOD bias sampler.
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    if (density) {
+        // the rest of the pyramid from the last band level.
+        glBindTexture(GL_TEXTURE_2D, density->ceiling);
+        std::vector<unsigned char> next;
+        int w = tailWidth, h = bands;
+        for (int level = bandLevels - 1; w > 1 || h > 1; ++level) {
+            next.resize((size_t)std::max(1, w / 2) * std::max(1, h / 2));
+            reduceCeilingLevel(tail.data(), w, h, next.data());
+            tail.swap(next);
+            w = std::max(1, w / 2);
+            h = std::max(1, h / 2);
+            glTexSubImage2D(GL_TEXTURE_2D, level + 1, 0, 0, w, h, GL_RED, GL_UNSIGNED_BYTE, tail.data());
+            if (level + 1 == EMPTY_TILE_LEVEL)
+                for (unsigned char v : tail)
+                    ++tileHistogram[v];
+        }
+        for (int v = 0; v < 256; ++v)
+            density->tilesBelow[v + 1] = density->tilesBelow[v] + tileHistogram[v];
+        density->tileCount = (width >> EMPTY_TILE_LEVEL) * (height >> EMPTY_TILE_LEVEL);
+        density->maxValue = tail[0] / 255.0f;
+        // a texel of a level stands for its whole block, blending between levels or texels would lower it.
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    
+    return textureID;
+}
+
+// strands baked into a tileable volume: x and y are the texture plane, z goes from root to tip.
+// They stand where the dots of the fur textures are, with the first texture's root radius, and
+// narrow into a paraboloid tip at a length of their own. slices gets the statistics of every slice.
+inline GLuint generateFurVolume(std::vector<FurDensity>& slices) {
+    const int size = FUR_VOLUME_SIZE;
+    const int depth = FUR_VOLUME_DEPTH;
+    srand(0);
+    std::vector<unsigned char> data((size_t)size * size * depth, 0);
+
+    // as many strands per texel as the fur textures have dots.
+    int numStrands = (size * size) / 10;
+    for (int i = 0; i < numStrands; ++i) {
+        int centerX = rand() % size;
+        int centerY = rand() % size;
+        float radius = FUR_DOT_SIZES[0] * furDotScale(rand() % 100) * FUR_TEXTURE_SIZE / 2;
+        // the dots of the fur textures are gone at about 40% of the fur length.
+        float length = 0.3f + 0.2f * (rand() % 100) / 100.0f;
+        int reach = (int)std::ceil(radius);
+        for (int z = 0; z < depth; ++z) {
+            float left = 1.0f - ((z + 0.5f) / depth) / length;
+            if (left <= 0.0f)
+                break;
+            unsigned char* slice = &data[(size_t)z * size * size];
+            for (int dy = -reach; dy <= reach; ++dy) {
+                for (int dx = -reach; dx <= reach; ++dx) {
+                    float value = left - (dx * dx + dy * dy) / (radius * radius);
+                    if (value <= 0.0f)
+                        continue;
+                    unsigned char& texel = slice[((centerY + dy + size) % size) * size + (centerX + dx + size) % size];
+                    texel = std::max(texel, static_cast<unsigned char>(value * 255));
+                }
+            }
+        }
+    }
+
+    slices.assign(depth, FurDensity());
+    for (int z = 0; z < depth; ++z) {
+        const unsigned char* slice = &data[(size_t)z * size * size];
+        for (size_t t = 0; t < (size_t)size * size; ++t)
+            ++slices[z].texels[slice[t]];
+        slices[z].maxValue = *std::max_element(slice, slice + (size_t)size * size) / 255.0f;
+    }
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_3D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, size, size, depth, 0, GL_RED, GL_UNSIGNED_BYTE, data.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    // root and tip must not blend into each other.
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // as with the 2D textures the mip chain is there for the LOD bias sampler.
+    glGenerateMipmap(GL_TEXTURE_3D);
+    return textureID;
+}
+
+// strands as a height map: every texel holds the height of the tallest strand over it, from the
+// root to the paraboloid tip at the strand's own length, so a shell keeps the texels still below
+// it. The dots are those of the first fur texture. slices gets the statistics of the alpha at the
+// bottom of every one of FUR_HEIGHT_SLICES even bands.
+inline GLuint generateFurHeights(std::vector<FurDensity>& slices) {
+    const int size = FUR_TEXTURE_SIZE;
+    srand(0);
+    std::vector<unsigned char> data((size_t)size * size, 0);
+
+    int numStrands = (size * size) / 10;
+    for (int i = 0; i < numStrands; ++i) {
+        int centerX = rand() % size;
+        int centerY = rand() % size;
+        float radius = FUR_DOT_SIZES[0] * furDotScale(rand() % 100) * size / 2;
+        // lengths of the volume's strands.
+        float length = 0.3f + 0.2f * (rand() % 100) / 100.0f;
+        int reach = (int)std::ceil(radius);
+        for (int dy = -reach; dy <= reach; ++dy) {
+            for (int dx = -reach; dx <= reach; ++dx) {
+                float height = length * (1.0f - (dx * dx + dy * dy) / (radius * radius));
+                if (height <= 0.0f)
+                    continue;
+                unsigned char& texel = data[((size_t)(centerY + dy + size) % size) * size + (centerX + dx + size) % size];
+                texel = std::max(texel, static_cast<unsigned char>(height * 255));
+            }
+        }
+    }
+
+    std::array<int, 256> heights{};
+    for (unsigned char v : data)
+        ++heights[v];
+    slices.assign(FUR_HEIGHT_SLICES, FurDensity());
+    for (int z = 0; z < FUR_HEIGHT_SLICES; ++z) {
+        float bottom = (float)z / FUR_HEIGHT_SLICES;
+        for (int v = 0; v < 256; ++v) {
+            float alpha = glm::clamp((v / 255.0f - bottom) / FUR_HEIGHT_RAMP, 0.0f, 1.0f);
+            int a = (int)(alpha * 255.0f + 0.5f);
+            slices[z].texels[a] += heights[v];
+            if (heights[v])
+                slices[z].maxValue = std::max(slices[z].maxValue, a / 255.0f);
+        }
+    }
+
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, size, size, 0, GL_RED, GL_UNSIGNED_BYTE, data.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    return textureID;
+}
+
+// shell heights of one fur and how opaque each shell is drawn. A shell stands for the fur between
+// itself and the next one: its alpha is raised to the optical depth of that slab over the depth of
+// one of the SHELL_LAYERS even layers at the shell, so fewer or uneven shells cover like those would.
+struct ShellTable {
+    int layers = 0;
+    ShellSpacing spacing = ShellSpacing::Linear;
+    std::vector<float> heights;     // layers + 1 entries, the last one is the tip.
+    std::vector<double> depth;      // optical depth from the root up to each height.
+    std::vector<double> ownDepth;   // optical depth of one even layer at each height.
+
+    // alpha power of shell i drawn in place of count shells (LOD stride, shell subset).
+    float power(int i, int count) const
+    {
+        if (ownDepth[i] <= 0.0)
+            return (float)count;
+        return (float)((depth[std::min(i + count, layers)] - depth[i]) / ownDepth[i]);
+    }
+};
+
+// which of count density levels spread evenly from root to tip a shell at height samples: the fur
+// texture, or the nearest slice of the volume below it.
+inline int densityLevel(size_t count, float height)
+{
+    return glm::clamp((int)(height * count), 0, (int)count - 1);
+}
+
+// optical depth of one of the SHELL_LAYERS even layers at height, from its level's coverage.
+inline double furLayerDepth(const std::vector<FurDensity>& density, float height)
+{
+    double coverage = density[densityLevel(density.size(), height)].coverage(1.0f - height * 0.5f);
+    return -std::log(1.0 - std::min(coverage, 0.999));
+}
+
+// pre-integrates the fur of the density levels over its length and places the shells.
+inline ShellTable buildShellTable(int layers, ShellSpacing spacing, const std::vector<FurDensity>& density)
+{
+    // depth up to the bottom of every even layer, linear in between.
+    std::vector<double> reference(SHELL_LAYERS + 1, 0.0);
+    for (int k = 0; k < SHELL_LAYERS; ++k)
+        reference[k + 1] = reference[k] + furLayerDepth(density, (float)k / SHELL_LAYERS);
+    auto depthAt = [&](float height) {
+        double x = std::min(std::max((double)height, 0.0), 1.0) * SHELL_LAYERS;
+        int k = std::min((int)x, SHELL_LAYERS - 1);
+        return reference[k] + (reference[k + 1] - reference[k]) * (x - k);
+    };
+
+    ShellTable table;
+    table.layers = layers;
+    table.spacing = spacing;
+    for (int i = 0; i <= layers; ++i) {
+        float height = (float)i / layers;
+        if (spacing == ShellSpacing::Root)
+            height *= height;
+        else if (spacing == ShellSpacing::Coverage && i < layers) {
+            // height below which the fur holds i / layers of its whole depth.
+            double wanted = reference[SHELL_LAYERS] * i / layers;
+            int k = (int)(std::upper_bound(reference.begin(), reference.end(), wanted) - reference.begin()) - 1;
+            k = glm::clamp(k, 0, SHELL_LAYERS - 1);
+            double slab = reference[k + 1] - reference[k];
+            height = (float)((k + (slab > 0.0 ? (wanted - reference[k]) / slab : 0.0)) / SHELL_LAYERS);
+        }
+        table.heights.push_back(height);
+        table.depth.push_back(depthAt(height));
+        table.ownDepth.push_back(furLayerDepth(density, height));
+    }
+    return table;
+}
+
+// create simple sphere for demonstration.
+inline void createSphere(std::vector<float>& vertices, std::vector<unsigned int>& indices, 
+                 float radius = 1.0f, int sectors = SPHERE_SECTORS, int stacks = SPHERE_STACKS) {
+    const float PI = 3.1415926f;
+    
+    float x, y, z, xy;
+    float nx, ny, nz, lengthInv = 1.0f / radius;
+    float s, t;
+    
+    float sectorStep = 2 * PI / sectors;
+    float stackStep = PI / stacks;
+    float sectorAngle, stackAngle;
+    
+    for(int i = 0; i <= stacks; ++i) {
+        stackAngle = PI / 2 - i * stackStep;
+        xy = radius * cosf(stackAngle);
+        z = radius * sinf(stackAngle);
+        
+        for(int j = 0; j <= sectors; ++j) {
+            sectorAngle = j * sectorStep;
+            
+            // position of vertex.
+            x = xy * cosf(sectorAngle);
+            y = xy * sinf(sectorAngle);
+            
+            // normal.
+            nx = x * lengthInv;
+            ny = y * lengthInv;
+            nz = z * lengthInv;
+            
+            // texture coords.
+            s = (float)j / sectors;
+            t = (float)i / stacks;
+            
+            // add the vertex.
+            vertices.push_back(x);
+            vertices.push_back(y);
+            vertices.push_back(z);
+            vertices.push_back(nx);
+            vertices.push_back(ny);
+            vertices.push_back(nz);
+            vertices.push_back(s);
+            vertices.push_back(t);
+        }
+    }
+    
+    // indexes generation.
+    for(int i = 0; i < stacks; ++i) {
+        int k1 = i * (sectors + 1);
+        int k2 = k1 + sectors + 1;
+        
+        for(int j = 0; j < sectors; ++j, ++k1, ++k2) {
+            if(i != 0) {
+                indices.push_back(k1);
+                indices.push_back(k2);
+                indices.push_back(k1 + 1);
+            }
+            
+            if(i != (stacks - 1)) {
+                indices.push_back(k1 + 1);
+                indices.push_back(k2);
+                indices.push_back(k2 + 1);
+            }
+        }
+    }
+}
+
+// shells of one object displaced and moved to world space once with transform feedback: shell i
+// starts at vertex i * the sphere's vertex count, in the layout of the sphere's vertex buffer. It
+// stays valid while the object keeps the model matrix, fur length and shell table it was captured with.
+struct ShellCache {
+    GLuint buffer = 0;
+    GLuint vao = 0;             // the sphere's attributes and indices over buffer.
+    int capacity = 0;           // shells buffer has room for.
+    int shells = 0;             // shells captured, 0 until the first capture.
+    glm::mat4 model = glm::mat4(1.0f);
+    float length = 0.0f;
+    const ShellTable* table = nullptr;
+    glm::mat4 lastModel = glm::mat4(1.0f);  // model of the previous frame.
+    bool still = false;         // the model is the previous frame's, a moving object isn't captured.
+};
+
+// owns all GL resources of the fur scene and draws one FrameSnapshot into a framebuffer.
+class FurRenderer
+{
+public:
+    RenderSettings settings;
+
+    FurRenderer(Profiler& profiler) : profiler(profiler), emptyTileTest(false), shader(nullptr), furShader(nullptr), temporalShader(nullptr), depthShader(nullptr), oitShader(nullptr), coverageShader(nullptr), stencilShader(nullptr), marchShader(nullptr),
+                                      cachedShader(nullptr), captureShader(nullptr),
+                                      upsampleShader(nullptr), taaShader(nullptr), oitResolveShader(nullptr), furData(FurData::Layers), sphereGeometry(SphereGeometry::Attributes), furVolume(0), furHeights(0), marchTable(nullptr), marchLimit(0), VAO(0), VBO(0), EBO(0), emptyVAO(0),
+                                      biasSampler(0), samplerBias(0.0f),
+                                      indexCount(0), framesRendered(0), temporalFrame(false), historyValid(false),
+                                      historyIndex(0), temporalIndex(0), stencilCulling(false), stencilRef(1), stencilRange(254), shellCacheFrame(false),
+                                      sphereVertexCount(0), shellDraws(0), cachedShellDraws(0), capturedShells(0) {}
+
+    // needs a current GL context. data picks how the fur density is stored and geometry where the
+    // sphere's vertices come from, neither can change later. settings should already be set, the
+    // programs they reach are compiled here.
+    void init(FurData data = FurData::Layers, SphereGeometry geometry = SphereGeometry::Attributes)
+    {
+        furData = data;
+        sphereGeometry = geometry;
+        if (sphereGeometry == SphereGeometry::Pulled && !VertexPool::supported()) {
+            std::cout << "ERROR::VERTEX_POOL:: vertex shaders can't read " << VertexPool::STORAGE_BLOCKS
+                      << " storage buffers here, the sphere uses vertex attributes" << std::endl;
+            sphereGeometry = SphereGeometry::Attributes;
+        }
+        // setting OpenGL
+        state.invalidate();
+        state.setDepthTest(true);
+        state.setBlend(true);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+        // submit shader programs first, the driver can compile them while the fur textures are generated.
+        // every fur program samples the same representation.
+        furDefines = furData == FurData::Volume ? "#define FUR_VOLUME\n" : furData == FurData::Heights ? "#define FUR_HEIGHTS\n" : "";
+        if (sphereGeometry == SphereGeometry::Procedural)
+            sphereDefines = "#define PROCEDURAL_SPHERE\n#define SPHERE_SECTORS " + std::to_string(SPHERE_SECTORS) +
+                            "\n#define SPHERE_STACKS " + std::to_string(SPHERE_STACKS) + "\n";
+        else if (sphereGeometry == SphereGeometry::Pulled)
+            sphereDefines = "#define VERTEX_PULLING\n";
+        // only what the current settings reach, other paths compile the first frame they are used
+        // in. Whether the fur programs carry the tile test depends on the textures, which come later,
+        // so they are submitted both ways.
+        std::vector<ProgramKind> planned = framePrograms(choosePaths(0, 0, false));
+        ShaderBatch shaderBatch;
+        std::vector<ProgramKind> submitted = submitPrograms(shaderBatch, planned, true);
+
+        std::fill(furTextures, furTextures + NUM_FUR_TEXTURES, 0);
+        std::chrono::steady_clock::time_point generationStart = std::chrono::steady_clock::now();
+        if (furData == FurData::Volume)
+            furVolume = generateFurVolume(furDensity);
+        else if (furData == FurData::Heights)
+            furHeights = generateFurHeights(furDensity);
+        else {
+            furDensity.resize(NUM_FUR_TEXTURES);
+            for (int i = 0; i < NUM_FUR_TEXTURES; ++i) {
+                int size = furTextureSize(FUR_DOT_SIZES[i]);
+                furTextures[i] = generateFurTexture(size, size, FUR_DOT_SIZES[i], &furDensity[i]);
+            }
+        }
+
+        glFinish();
+        double generationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generationStart).count();
+
+        // the tile test only goes into the fur programs when the textures have layers it pays off for.
+        emptyTileTest = emptyTilesUseful();
+        storePrograms(shaderBatch, submitted);
+        shaderBatch.printReport();
+        std::cout << "fur data: " << furDataName(furData) << ", generated and uploaded in " << generationMs << " ms" << std::endl;
+        std::string cacheBlocker = shellCacheBlocker();
+        if (!cacheBlocker.empty())
+            std::cout << "shell cache: not used with " << cacheBlocker << std::endl;
+
+        // Sphere creation
+        // the procedural and the pulled sphere draw from a VAO without attributes.
+        glGenVertexArrays(1, &VAO);
+        if (sphereGeometry == SphereGeometry::Attributes)
+            createSphereBuffers();
+        else if (sphereGeometry == SphereGeometry::Pulled)
+            createSpherePool();
+        // full screen passes generate their vertices, core profile still wants a VAO bound.
+        glGenVertexArrays(1, &emptyVAO);
+
+        // fur texture sampling with mipmaps and a LOD bias, bound only while settings.mipBias > 0.
+        glGenSamplers(1, &biasSampler);
+        glSamplerParameteri(biasSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glSamplerParameteri(biasSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glSamplerParameteri(biasSampler, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glSamplerParameteri(biasSampler, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glSamplerParameteri(biasSampler, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        samplerBias = 0.0f;
+        // the texture and VAO setup above went around the cache.
+        state.invalidate();
+
+        // profiler scope names for every batch of SHELL_BATCH shells.
+        for (int i = 0; i < MAX_SHELL_LAYERS; i += SHELL_BATCH)
+            shellBatchNames.push_back("shells " + std::to_string(i) + "-" + std::to_string(std::min(i + SHELL_BATCH, MAX_SHELL_LAYERS) - 1));
+    }
+
+    // draw the frame into targetFBO (0 is the default framebuffer).
+    void render(const FrameSnapshot& frame, GLuint targetFBO, int width, int height)
+    {
+        // offscreen targets are (re)created first, that touches bindings the cache then has to redo.
+        FramePaths paths = choosePaths(width, height, true);
+        temporalFrame = paths.temporal;
+        bool scaled = paths.scaled;
+        bool coverageFrame = paths.coverage;
+        bool oitFrame = paths.oit;
+        bool stencilFrame = paths.stencil;
+        shellCacheFrame = paths.shellCache;
+        requirePrograms(framePrograms(paths));
+        if (!temporalFrame)
+            historyValid = false;
+        // with temporal accumulation the scene goes to an offscreen target first and is resolved into targetFBO.
+        GLuint sceneFBO = temporalFrame ? sceneTarget.FBO : targetFBO;
+        state.bindFramebuffer(sceneFBO);
+        state.viewport(0, 0, width, height);
+
+        profiler.beginFrame();
+        int frameScope = profiler.beginScope("frame");
+        {
+            ProfileScope scope(profiler, "clear");
+            glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+            if (stencilFrame) {
+                // 0xFF passes every shell and saturates, the base layers write their objects' counts.
+                state.clearStencil(0xFF);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+            } else {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            }
+            if (temporalFrame) {
+                static const GLfloat still[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                glClearBufferfv(GL_COLOR, 1, still);
+            }
+        }
+
+        int setupScope = profiler.beginScope("setup");
+        // don't forget to enable shader before setting uniforms
+        shader = temporalFrame ? temporalShader : furShader;
+        state.useProgram(shader->ID);
+
+        glm::mat4 projection = glm::perspective(glm::radians(frame.zoom), (float)width / (float)height, NEAR_PLANE, FAR_PLANE);
+        glm::mat4 viewProjection = projection * frame.view;
+        float focalPixels = projection[1][1] * height * 0.5f;
+        for (int o = 0; o < frame.objectCount; ++o) {
+            ShellLod& lod = lods[o];
+            lod = settings.shellLod ? computeShellLod(frame.objects[o], frame.cameraPosition, focalPixels) : ShellLod();
+            while (settings.shellBudget > 0 && frame.objects[o].fur.shellLayers / lod.stride > settings.shellBudget) {
+                lod.stride *= 2;
+                lod.fade = 1.0f;
+            }
+        }
+        for (int o = 0; o < frame.objectCount; ++o) {
+            ShellCache& cache = shellCaches[o];
+            cache.still = framesRendered > 0 && cache.lastModel == frame.objects[o].model;
+            cache.lastModel = frame.objects[o].model;
+        }
+        // blended shells don't write depth, so objects are drawn back to front unless the blending
+        // doesn't depend on the order.
+        for (int o = 0; o < frame.objectCount; ++o)
+            drawOrder[o] = o;
+        if (!oitFrame)
+            std::sort(drawOrder.begin(), drawOrder.begin() + frame.objectCount, [&](int a, int b) {
+                return glm::length(glm::vec3(frame.objects[a].model[3]) - frame.cameraPosition) >
+                       glm::length(glm::vec3(frame.objects[b].model[3]) - frame.cameraPosition);
+            });
+        if (temporalFrame) {
+            // motion vectors come from the unjittered matrices, only the rasterized image is jittered.
+            shader->setMat4("viewProjection", viewProjection);
+            shader->setMat4("prevViewProjection", historyValid ? previousViewProjection : viewProjection);
+            glm::vec2 jitter = taaJitter(temporalIndex);
+            projection[2][0] += jitter.x * 2.0f / width;
+            projection[2][1] += jitter.y * 2.0f / height;
+        }
+        shader->setMat4("view", frame.view);
+        shader->setMat4("projection", projection);
+        frameProjection = projection;
+        if (shellCacheFrame) {
+            state.useProgram(cachedShader->ID);
+            cachedShader->setMat4("view", frame.view);
+            cachedShader->setMat4("projection", projection);
+            state.useProgram(shader->ID);
+        }
+
+        // texture binding, after the first frame these are all no-ops.
+        if (settings.mipBias > 0.0f && settings.mipBias != samplerBias) {
+            glSamplerParameterf(biasSampler, GL_TEXTURE_LOD_BIAS, settings.mipBias);
+            samplerBias = settings.mipBias;
+        }
+        if (furData == FurData::Volume) {
+            state.bindTexture(FUR_VOLUME_UNIT, GL_TEXTURE_3D, furVolume);
+            state.bindSampler(FUR_VOLUME_UNIT, settings.mipBias > 0.0f ? biasSampler : 0);
+        }
+        else if (furData == FurData::Heights) {
+            state.bindTexture(FUR_HEIGHTS_UNIT, GL_TEXTURE_2D, furHeights);
+            state.bindSampler(FUR_HEIGHTS_UNIT, settings.mipBias > 0.0f ? biasSampler : 0);
+        }
+        else {
+            for (int i = 0; i < NUM_FUR_TEXTURES; ++i) {
+                state.bindTexture(i, GL_TEXTURE_2D, furTextures[i]);
+                state.bindSampler(i, settings.mipBias > 0.0f ? biasSampler : 0);
+                state.bindTexture(CEILING_UNIT + i, GL_TEXTURE_2D, furDensity[i].ceiling);
+            }
+        }
+        profiler.endScope(setupScope);
+
+        // rendering all layers (shell-texturing).
+        state.bindVertexArray(VAO);
+        if (scaled)
+            renderScaled(frame, sceneFBO, width, height);
+        else if (coverageFrame)
+            renderCoverage(frame, projection, sceneFBO, width, height);
+        else {
+            drawDepthPrepass(frame, projection);
+            {
+                // base color only where the pre-pass left the nearest depth, no second depth write.
+                ProfileScope scope(profiler, "base");
+                state.depthMask(false);
+                state.depthFunc(GL_LEQUAL);
+                if (stencilFrame) {
+                    // the visible base layer starts its object's shell count in the stencil.
+                    state.setStencilTest(true);
+                    state.stencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+                    for (int i = 0; i < frame.objectCount; ++i) {
+                        state.stencilFunc(GL_ALWAYS, stencilBase(i, frame.objectCount));
+                        drawShells(frame, drawOrder[i], 0, 1);
+                    }
+                    state.setStencilTest(false);
+                } else {
+                    for (int o = 0; o < frame.objectCount; ++o)
+                        drawShells(frame, o, 0, 1);
+                }
+                state.depthFunc(GL_LESS);
+            }
+            // shells only test against the base layers, occluded fragments are rejected before shading.
+            if (oitFrame)
+                renderOit(frame, projection, sceneFBO);
+            else if (stencilFrame)
+                drawStencilCulled(frame, projection);
+            else {
+                for (int i = 0; i < frame.objectCount; ++i)
+                    drawFur(frame, drawOrder[i]);
+            }
+            state.depthMask(true);
+        }
+        if (temporalFrame) {
+            resolveTemporal(targetFBO, width, height);
+            ++temporalIndex;
+        }
+
+        previousViewProjection = viewProjection;
+        for (int o = 0; o < frame.objectCount; ++o)
+            previousModels[o] = frame.objects[o].model;
+        profiler.endScope(frameScope);
+        profiler.endFrame();
+        ++framesRendered;
+    }
+
+    // next entry of FUR_SCALES, wraps around.
+    void cycleFurScale()
+    {
+        int next = 0;
+        for (int i = 0; i < NUM_FUR_SCALES; ++i)
+            if (settings.furScale == FUR_SCALES[i])
+                next = (i + 1) % NUM_FUR_SCALES;
+        settings.furScale = FUR_SCALES[next];
+    }
+
+    void toggleRayMarch()
+    {
+        settings.rayMarch = !settings.rayMarch;
+    }
+
+    void toggleStencilCull()
+    {
+        settings.stencilCull = !settings.stencilCull;
+    }
+
+    void toggleAlphaToCoverage()
+    {
+        settings.alphaToCoverage = !settings.alphaToCoverage;
+    }
+
+    void toggleOit()
+    {
+        settings.oit = !settings.oit;
+    }
+
+    void toggleShellCache()
+    {
+        settings.shellCache = !settings.shellCache;
+    }
+
+    // switch between all shells and DEFAULT_SHELL_SUBSET shells per frame with temporal accumulation.
+    void toggleShellSubset()
+    {
+        settings.shellSubset = settings.shellSubset > 0 ? 0 : DEFAULT_SHELL_SUBSET;
+    }
+
+    void toggleShellLod()
+    {
+        settings.shellLod = !settings.shellLod;
+    }
+
+    // frames to render before the image of a still scene stops changing. The shell cache captures
+    // an object in the second frame it stands still, the image test should see the cached shells.
+    int settleFrames() const
+    {
+        if (settings.shellSubset > 0)
+            return TAA_SETTLE_FRAMES;
+        return settings.shellCache ? 2 : 1;
+    }
+
+    // drop the accumulated history, e.g. on a camera cut.
+    void resetHistory()
+    {
+        historyValid = false;
+    }
+
+    // call after GL code outside the renderer changed bindings or enables (e.g. created textures).
+    void invalidateState()
+    {
+        state.invalidate();
+    }
+
+    // viewport of the window after a resize, through the cache so its copy doesn't go stale.
+    void resizeViewport(int width, int height)
+    {
+        state.viewport(0, 0, width, height);
+    }
+
+    void printStateStats() const
+    {
+        state.printStats(framesRendered);
+    }
+
+    // where the sphere's vertices come from, init falls back to attributes if pulling isn't supported.
+    SphereGeometry geometry() const
+    {
+        return sphereGeometry;
+    }
+
+    // the setting that keeps the requested shell cache off, empty if the cache is used or off anyway.
+    std::string shellCacheBlocker()
+    {
+        FramePaths paths = choosePaths(0, 0, false);
+        if (!settings.shellCache || paths.shellCache)
+            return "";
+        if (sphereGeometry != SphereGeometry::Attributes)
+            return std::string("--sphere-geometry ") + sphereGeometryName(sphereGeometry);
+        if (paths.temporal)
+            return "--shell-subset";
+        if (paths.scaled)
+            return "--fur-scale below 1";
+        if (paths.coverage)
+            return "--alpha-to-coverage";
+        if (paths.oit)
+            return "--oit";
+        return "--stencil-cull";
+    }
+
+    // how many shell draws came from the cache, each one skipped displacing the sphere's vertices
+    // and inverting the model matrix for them.
+    void printShellCacheStats()
+    {
+        std::string blocker = shellCacheBlocker();
+        if (!blocker.empty() && !cachedShellDraws) {
+            std::cout << "shell cache: not used with " << blocker << std::endl;
+            return;
+        }
+        std::cout << "shell cache: " << cachedShellDraws << " of " << shellDraws << " shell draws from the cache";
+        if (shellDraws)
+            std::cout << " (" << (100.0 * cachedShellDraws / shellDraws) << "%)";
+        std::cout << ", " << cachedShellDraws * sphereVertexCount << " vertices not displaced, "
+                  << capturedShells << " shells captured (" << capturedShells * sphereVertexCount << " vertices)" << std::endl;
+    }
+
+    void release()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        vertexPool.release();
+        glDeleteVertexArrays(1, &emptyVAO);
+        for (ShellCache& cache : shellCaches) {
+            glDeleteVertexArrays(1, &cache.vao);
+            glDeleteBuffers(1, &cache.buffer);
+            cache = ShellCache();
+        }
+        glDeleteSamplers(1, &biasSampler);
+        glDeleteTextures(NUM_FUR_TEXTURES, furTextures);
+        glDeleteTextures(1, &furVolume);
+        glDeleteTextures(1, &furHeights);
+        for (FurDensity& density : furDensity)
+            glDeleteTextures(1, &density.ceiling);
+        furTarget.release();
+        depthGuide.release();
+        sceneTarget.release();
+        historyTargets[0].release();
+        historyTargets[1].release();
+        oitTarget.release();
+        coverageTarget.release();
+        coverageResolve.release();
+        historyValid = false;
+        for (Shader& program : programs)
+            glDeleteProgram(program.ID);
+        programs.clear();
+        shader = nullptr;
+        for (int kind = 0; kind < NUM_PROGRAM_KINDS; ++kind)
+            programSlot((ProgramKind)kind) = nullptr;
+        state.invalidate();
+    }
+
+private:
+    // every program the renderer draws with, each has a named pointer below (programSlot()).
+    enum ProgramKind {
+        FUR_PROGRAM, TEMPORAL_PROGRAM, DEPTH_PROGRAM, OIT_PROGRAM, OIT_RESOLVE_PROGRAM, COVERAGE_PROGRAM,
+        STENCIL_PROGRAM, MARCH_PROGRAM, CACHED_PROGRAM, CAPTURE_PROGRAM, UPSAMPLE_PROGRAM, TAA_PROGRAM,
+        NUM_PROGRAM_KINDS
+    };
+
+    // the ways a frame can draw its fur, see choosePaths().
+    struct FramePaths {
+        bool temporal = false;
+        bool scaled = false;
+        bool coverage = false;
+        bool oit = false;
+        bool stencil = false;
+        bool shellCache = false;
+    };
+
+    // units of the upsample inputs, kept apart from the fur textures so those stay bound.
+    static const int UPSAMPLE_COLOR_UNIT = NUM_FUR_TEXTURES;
+    static const int UPSAMPLE_DEPTH_UNIT = NUM_FUR_TEXTURES + 1;
+    static const int UPSAMPLE_SCENE_DEPTH_UNIT = NUM_FUR_TEXTURES + 2;
+    static const int TAA_CURRENT_UNIT = NUM_FUR_TEXTURES + 3;
+    static const int TAA_VELOCITY_UNIT = NUM_FUR_TEXTURES + 4;
+    static const int TAA_HISTORY_UNIT = NUM_FUR_TEXTURES + 5;
+    static const int OIT_ACCUMULATION_UNIT = NUM_FUR_TEXTURES + 6;
+    static const int OIT_REVEALAGE_UNIT = NUM_FUR_TEXTURES + 7;
+    static const int CEILING_UNIT = NUM_FUR_TEXTURES + 8;      // NUM_FUR_TEXTURES units from here.
+    static const int TILE_CEILING_UNIT = CEILING_UNIT + NUM_FUR_TEXTURES;
+    static const int FUR_VOLUME_UNIT = TILE_CEILING_UNIT + 1;
+    static const int FUR_HEIGHTS_UNIT = FUR_VOLUME_UNIT + 1;
+
+    Profiler& profiler;
+    std::deque<Shader> programs;    // every program compiled so far, the pointers below point in here.
+    std::string furDefines;         // defines of the fur representation, in every fur program.
+    std::string sphereDefines;      // defines of the sphere geometry, in the programs that draw the sphere.
+    bool emptyTileTest;             // the fur programs test empty tiles, decided from the textures.
+    Shader* shader;             // fur program of the current frame, one of the two below.
+    Shader* furShader;
+    Shader* temporalShader;     // also writes motion vectors.
+    Shader* depthShader;        // fur program without any shading, for the depth pre-pass.
+    Shader* oitShader;          // fur program writing weighted color and revealage.
+    Shader* coverageShader;     // fur program for opaque shells with alpha-to-coverage, never discards.
+    Shader* stencilShader;      // fur program without forced early tests, discards must not touch the stencil.
+    Shader* marchShader;        // ray-marches the fur layers under a single hull.
+    Shader* cachedShader;       // furShader drawing shells from a ShellCache.
+    Shader* captureShader;      // writes displaced shell vertices to transform feedback.
+    Shader* upsampleShader;
+    Shader* taaShader;
+    Shader* oitResolveShader;
+    FurData furData;
+    SphereGeometry sphereGeometry;
+    GLuint furTextures[NUM_FUR_TEXTURES];
+    GLuint furVolume;
+    GLuint furHeights;
+    // one entry per fur texture, per slice of furVolume or per band of furHeights, evenly spread from root to tip.
+    std::vector<FurDensity> furDensity;
+    std::deque<ShellTable> shellTables;     // entries never move, marchTable points into it.
+    const ShellTable* marchTable;   // layers last uploaded to marchShader.
+    int marchLimit;
+    GLuint VAO, VBO, EBO;
+    VertexPool vertexPool;      // storage buffers of the pulled sphere.
+    PooledMesh sphereMesh;
+    GLuint emptyVAO;
+    GLuint biasSampler;
+    float samplerBias;          // GL_TEXTURE_LOD_BIAS currently set on biasSampler.
+    Framebuffer furTarget;      // shells at settings.furScale, premultiplied color + coverage.
+    Framebuffer depthGuide;     // full resolution depth of the base layer, guides the upsample.
+    Framebuffer sceneTarget;    // current frame before the temporal resolve, motion vectors in the second attachment.
+    Framebuffer historyTargets[2];
+    Framebuffer coverageTarget; // multisampled color and depth of the alpha-to-coverage path.
+    Framebuffer coverageResolve; // single-sample RGBA8 resolve of coverageTarget.
+    Framebuffer oitTarget;      // weighted color sum and revealage of the OIT shells, own copy of the base depth.
+    GLsizei indexCount;
+    std::vector<std::string> shellBatchNames;
+    GLStateCache state;
+    unsigned long long framesRendered;
+    bool temporalFrame;
+    bool historyValid;
+    int historyIndex;           // historyTargets entry that holds the last resolved frame.
+    unsigned int temporalIndex;
+    glm::mat4 previousViewProjection;
+    glm::mat4 frameProjection;  // projection of the frame being rendered, jittered in temporal frames.
+    std::array<glm::mat4, MAX_SCENE_OBJECTS> previousModels;
+    std::array<ShellLod, MAX_SCENE_OBJECTS> lods;
+    std::array<int, MAX_SCENE_OBJECTS> drawOrder;    // object indices, farthest first.
+    bool stencilCulling;        // drawShells counts surviving shells in the stencil.
+    int stencilRef;             // stencil value of the current object's base layer.
+    int stencilRange;           // stencil values each object counts in.
+    bool shellCacheFrame;       // drawShells may draw shells above the base layer from shellCaches.
+    std::array<ShellCache, MAX_SCENE_OBJECTS> shellCaches;
+    GLint sphereVertexCount;
+    unsigned long long shellDraws;          // shells above the base layer drawn with the fur program.
+    unsigned long long cachedShellDraws;
+    unsigned long long capturedShells;
+
+    // which path a frame takes with the current settings. With prepare the targets of the paths are
+    // (re)created and a path whose targets fail is dropped; without, the plan before any exist.
+    FramePaths choosePaths(int width, int height, bool prepare)
+    {
+        FramePaths paths;
+        paths.temporal = settings.shellSubset > 0 && (!prepare || prepareTemporalTargets(width, height));
+        paths.scaled = settings.furScale < 1.0f && (!prepare || prepareScaledTargets(width, height));
+        paths.coverage = settings.alphaToCoverage && !paths.scaled && !paths.temporal && (!prepare || prepareCoverageTarget(width, height));
+        paths.oit = settings.oit && !paths.scaled && !paths.coverage && (!prepare || prepareOitTarget(width, height));
+        // the stencil test needs the fur textures' ceilings, the volume has none.
+        paths.stencil = settings.stencilCull && furData == FurData::Layers && !paths.scaled && !paths.coverage && !paths.oit && !paths.temporal;
+        // the cache only serves the plain blended shells, the other paths have programs of their own.
+        paths.shellCache = settings.shellCache && sphereGeometry == SphereGeometry::Attributes && !paths.scaled &&
+                           !paths.coverage && !paths.oit && !paths.stencil && !paths.temporal;
+        return paths;
+    }
+
+    // programs a frame on paths draws with.
+    std::vector<ProgramKind> framePrograms(const FramePaths& paths) const
+    {
+        std::vector<ProgramKind> kinds;
+        // the fur program is also the one the other non-temporal paths return to.
+        kinds.push_back(paths.temporal ? TEMPORAL_PROGRAM : FUR_PROGRAM);
+        if (paths.temporal)
+            kinds.push_back(TAA_PROGRAM);
+        bool shells = true;
+        if (paths.scaled) {
+            kinds.push_back(UPSAMPLE_PROGRAM);
+        } else if (paths.coverage) {
+            kinds.push_back(COVERAGE_PROGRAM);
+            shells = false;
+        } else {
+            kinds.push_back(DEPTH_PROGRAM);
+            if (paths.oit) {
+                kinds.push_back(OIT_PROGRAM);
+                kinds.push_back(OIT_RESOLVE_PROGRAM);
+                shells = false;
+            } else if (paths.stencil) {
+                kinds.push_back(STENCIL_PROGRAM);
+                shells = false;
+            }
+        }
+        if (shells && !paths.temporal && (settings.rayMarch || settings.rayMarchDistance > 0.0f))
+            kinds.push_back(MARCH_PROGRAM);
+        if (paths.shellCache) {
+            kinds.push_back(CACHED_PROGRAM);
+            kinds.push_back(CAPTURE_PROGRAM);
+        }
+        return kinds;
+    }
+
+    // named pointer of a program kind, null until it is compiled.
+    Shader*& programSlot(ProgramKind kind)
+    {
+        switch (kind) {
+        case FUR_PROGRAM: return furShader;
+        case TEMPORAL_PROGRAM: return temporalShader;
+        case DEPTH_PROGRAM: return depthShader;
+        case OIT_PROGRAM: return oitShader;
+        case OIT_RESOLVE_PROGRAM: return oitResolveShader;
+        case COVERAGE_PROGRAM: return coverageShader;
+        case STENCIL_PROGRAM: return stencilShader;
+        case MARCH_PROGRAM: return marchShader;
+        case CACHED_PROGRAM: return cachedShader;
+        case CAPTURE_PROGRAM: return captureShader;
+        case UPSAMPLE_PROGRAM: return upsampleShader;
+        default: return taaShader;
+        }
+    }
+
+    void addProgram(ShaderBatch& batch, ProgramKind kind, bool emptyTiles) const
+    {
+        // the shell cache captures and draws the vertex buffers, it works without the sphere's define.
+        std::string fur = furDefines + sphereDefines;
+        std::string tiles = emptyTiles ? "#define EMPTY_TILES\n" : "";
+        switch (kind) {
+        case FUR_PROGRAM: batch.addVariant(emptyTiles ? "fur tiles" : "fur", fur + tiles, "fur_shader.verx", "fur_shader.frag"); break;
+        case TEMPORAL_PROGRAM: batch.addVariant("fur temporal", fur + "#define TEMPORAL\n", "fur_shader.verx", "fur_shader.frag"); break;
+        case DEPTH_PROGRAM: batch.addVariant("fur depth", fur + "#define DEPTH_ONLY\n", "fur_shader.verx", "fur_shader.frag"); break;
+        case OIT_PROGRAM: batch.addVariant("fur oit", fur + "#define OIT\n", "fur_shader.verx", "fur_shader.frag"); break;
+        case OIT_RESOLVE_PROGRAM: batch.add("oit resolve", "fullscreen_shader.verx", "oit_resolve.frag"); break;
+        case COVERAGE_PROGRAM: batch.addVariant("fur coverage", fur + "#define ALPHA_TO_COVERAGE\n", "fur_shader.verx", "fur_shader.frag"); break;
+        case STENCIL_PROGRAM: batch.addVariant("fur stencil", fur + "#define STENCIL_CULL\n", "fur_shader.verx", "fur_shader.frag"); break;
+        case MARCH_PROGRAM: batch.addVariant("fur march", fur, "fur_shader.verx", "fur_march.frag"); break;
+        case CACHED_PROGRAM: batch.addVariant(emptyTiles ? "fur cached tiles" : "fur cached", furDefines + "#define SHELL_CACHED\n" + tiles, "fur_shader.verx", "fur_shader.frag"); break;
+        case CAPTURE_PROGRAM: batch.addCapture("shell capture", furDefines, "fur_shader.verx", { "FragPos", "Normal", "TexCoord" }); break;
+        case UPSAMPLE_PROGRAM: batch.add("upsample", "fullscreen_shader.verx", "upsample_shader.frag"); break;
+        default: batch.add("taa", "fullscreen_shader.verx", "taa_shader.frag"); break;
+        }
+    }
+
+    // uniforms of a new program that never change, they stay in the program object.
+    void configureProgram(ProgramKind kind, Shader& program)
+    {
+        switch (kind) {
+        case DEPTH_PROGRAM:
+        case CAPTURE_PROGRAM:
+            break;
+        case UPSAMPLE_PROGRAM:
+            state.useProgram(program.ID);
+            program.setInt("furColor", UPSAMPLE_COLOR_UNIT);
+            program.setInt("furDepth", UPSAMPLE_DEPTH_UNIT);
+            program.setInt("sceneDepth", UPSAMPLE_SCENE_DEPTH_UNIT);
+            program.setFloat("nearPlane", NEAR_PLANE);
+            program.setFloat("farPlane", FAR_PLANE);
+            break;
+        case OIT_RESOLVE_PROGRAM:
+            state.useProgram(program.ID);
+            program.setInt("accumulation", OIT_ACCUMULATION_UNIT);
+            program.setInt("revealage", OIT_REVEALAGE_UNIT);
+            break;
+        case TAA_PROGRAM:
+            state.useProgram(program.ID);
+            program.setInt("currentColor", TAA_CURRENT_UNIT);
+            program.setInt("velocityMap", TAA_VELOCITY_UNIT);
+            program.setInt("historyColor", TAA_HISTORY_UNIT);
+            break;
+        default:
+            setFurConstants(program);
+            break;
+        }
+    }
+
+    // submits the programs of kinds that aren't compiled yet, returns them in the order of the batch.
+    // With bothTileVariants the fur programs are added once more with the tile test, storePrograms()
+    // keeps the one emptyTileTest asks for.
+    std::vector<ProgramKind> submitPrograms(ShaderBatch& batch, const std::vector<ProgramKind>& kinds, bool bothTileVariants = false)
+    {
+        std::vector<ProgramKind> added;
+        for (ProgramKind kind : kinds) {
+            if (programSlot(kind) || std::find(added.begin(), added.end(), kind) != added.end())
+                continue;
+            addProgram(batch, kind, bothTileVariants ? false : emptyTileTest);
+            added.push_back(kind);
+        }
+        size_t count = added.size();
+        for (size_t i = 0; bothTileVariants && i < count; ++i) {
+            if (added[i] == FUR_PROGRAM || added[i] == CACHED_PROGRAM) {
+                addProgram(batch, added[i], true);
+                added.push_back(added[i]);
+            }
+        }
+        if (!added.empty())
+            batch.submit();
+        return added;
+    }
+
+    // waits for a submitted batch and hands its programs to their named pointers.
+    void storePrograms(ShaderBatch& batch, const std::vector<ProgramKind>& added)
+    {
+        if (added.empty())
+            return;
+        std::vector<Shader> compiled = batch.finish();
+        for (size_t i = 0; i < added.size(); ++i) {
+            // a kind added twice came without the tile test first and with it second.
+            bool first = std::find(added.begin(), added.begin() + i, added[i]) == added.begin() + i;
+            bool twice = !first || std::find(added.begin() + i + 1, added.end(), added[i]) != added.end();
+            if (twice && first == emptyTileTest) {
+                glDeleteProgram(compiled[i].ID);
+                continue;
+            }
+            programs.push_back(compiled[i]);
+            programSlot(added[i]) = &programs.back();
+            configureProgram(added[i], programs.back());
+        }
+    }
+
+    // compiles the programs of kinds a frame is about to use for the first time, that frame stalls for them.
+    void requirePrograms(const std::vector<ProgramKind>& kinds)
+    {
+        ShaderBatch batch;
+        std::vector<ProgramKind> added = submitPrograms(batch, kinds);
+        if (added.empty())
+            return;
+        storePrograms(batch, added);
+        batch.printReport();
+    }
+
+    // vertex and index buffers of the sphere in VAO.
+    void createSphereBuffers()
+    {
+        std::vector<float> sphereVertices;
+        std::vector<unsigned int> sphereIndices;
+        createSphere(sphereVertices, sphereIndices);
+        indexCount = (GLsizei)sphereIndices.size();
+
+        sphereVertexCount = (GLint)(sphereVertices.size() / 8);
+
+        // element buffer bindings belong to the bound VAO.
+        glBindVertexArray(VAO);
+        glGenBuffers(1, &VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
+
+        glGenBuffers(1, &EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
+
+        setSphereAttributes(VAO, VBO);
+    }
+
+    // the sphere packed into vertexPool, whose buffers stay bound to their storage buffer bindings
+    // and whose mesh table is VAO's only vertex data.
+    void createSpherePool()
+    {
+        // the pool refuses meshes its 16-bit indices don't reach.
+        static_assert((SPHERE_STACKS + 1) * (SPHERE_SECTORS + 1) <= (int)VertexPool::MAX_MESH_VERTICES, "sphere too fine for the vertex pool");
+        std::vector<float> sphereVertices;
+        std::vector<unsigned int> sphereIndices;
+        createSphere(sphereVertices, sphereIndices);
+        indexCount = (GLsizei)sphereIndices.size();
+        sphereVertexCount = (GLint)(sphereVertices.size() / 8);
+
+        sphereMesh = vertexPool.add(sphereVertices, sphereIndices);
+        vertexPool.upload();
+        vertexPool.bind();
+        vertexPool.attach(VAO);
+        std::cout << "sphere: " << vertexPool.size() << " bytes pulled from storage buffers instead of "
+                  << sphereVertices.size() * sizeof(float) + sphereIndices.size() * sizeof(unsigned int)
+                  << " in vertex and index buffers" << std::endl;
+    }
+
+    // vao reads the sphere's vertex layout from buffer and its indices from EBO.
+    void setSphereAttributes(GLuint vao, GLuint buffer)
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        // positions.
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        // normals.
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        // texture coords.
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+
+        glBindVertexArray(0);
+    }
+
+    // cache of object index holding all shells below its fur limit, captured now if the object
+    // didn't move since the previous frame. Null if the shells have to be displaced as usual.
+    ShellCache* shellCache(int index, const ObjectState& object, const ShellTable& table)
+    {
+        ShellCache& cache = shellCaches[index];
+        int limit = furLayerLimit(table);
+        if (cache.shells == limit && cache.model == object.model && cache.length == object.fur.length && cache.table == &table)
+            return &cache;
+        if (!cache.still)
+            return nullptr;
+
+        ProfileScope scope(profiler, "shell capture");
+        GLsizeiptr shellBytes = (GLsizeiptr)sphereVertexCount * 8 * sizeof(float);
+        if (!cache.buffer) {
+            glGenBuffers(1, &cache.buffer);
+            glGenVertexArrays(1, &cache.vao);
+            setSphereAttributes(cache.vao, cache.buffer);
+            // setSphereAttributes bound a vertex array and buffer past the state cache.
+            state.invalidate();
+        }
+        if (cache.capacity < limit) {
+            // the state cache doesn't track buffer bindings, the transform feedback ones go direct.
+            glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, cache.buffer);
+            glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, shellBytes * limit, nullptr, GL_STATIC_DRAW);
+            cache.capacity = limit;
+        }
+        state.useProgram(captureShader->ID);
+        captureShader->setMat4("model", object.model);
+        captureShader->setFloat("furLength", object.fur.length);
+        state.bindVertexArray(VAO);
+        glEnable(GL_RASTERIZER_DISCARD);
+        for (int i = 0; i < limit; ++i) {
+            captureShader->setFloat("shellHeight", table.heights[i]);
+            glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, cache.buffer, shellBytes * i, shellBytes);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, sphereVertexCount);
+            glEndTransformFeedback();
+        }
+        glDisable(GL_RASTERIZER_DISCARD);
+        // unbound directly as well, nothing else draws with the cache's buffer attached.
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        state.useProgram(shader->ID);
+
+        cache.shells = limit;
+        cache.model = object.model;
+        cache.length = object.fur.length;
+        cache.table = &table;
+        capturedShells += limit;
+        return &cache;
+    }
+
+    // one sphere with the current program. The procedural one is an instance per stack with two
+    // triangles per sector, fur_shader.verx collapses those createSphere leaves out at the poles.
+    // The pulled sphere is the pool's only mesh, VAO reads its row of the mesh table.
+    void drawSphere()
+    {
+        if (sphereGeometry == SphereGeometry::Procedural)
+            glDrawArraysInstanced(GL_TRIANGLES, 0, 6 * SPHERE_SECTORS, SPHERE_STACKS);
+        else if (sphereGeometry == SphereGeometry::Pulled)
+            VertexPool::draw(sphereMesh);
+        else
+            glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
+    }
+
+    void setFurConstants(Shader& program)
+    {
+        // uniforms that never change are set once, they stay in the program object.
+        state.useProgram(program.ID);
+        for (int i = 0; i < NUM_FUR_TEXTURES; ++i)
+            program.setInt("furTextures[" + std::to_string(i) + "]", i);
+        for (int i = 0; i < NUM_FUR_TEXTURES; ++i)
+            program.setInt("furCeilings[" + std::to_string(i) + "]", CEILING_UNIT + i);
+        program.setVec3("lightPos", glm::vec3(5.0f, 5.0f, 5.0f));
+        program.setVec3("viewPos", glm::vec3(3.0f, 3.0f, 3.0f));
+        program.setVec3("lightColor", glm::vec3(1.0f, 1.0f, 1.0f));
+        program.setFloat("shellAlphaPower", 1.0f);
+        program.setFloat("lodFade", 1.0f);
+        program.setFloat("lodCoarsePower", 2.0f);
+        program.setBool("lodFineOnly", false);
+        program.setBool("emptyTiles", false);
+        program.setBool("isBaseLayer", false);
+        program.setInt("tileCeiling", TILE_CEILING_UNIT);
+        program.setInt("furVolume", FUR_VOLUME_UNIT);
+        program.setInt("furHeights", FUR_HEIGHTS_UNIT);
+    }
+
+    // true if some texture has enough empty tiles at the highest cutoff it is used with, drawShells
+    // decides per layer.
+    bool emptyTilesUseful() const
+    {
+        for (size_t i = 0; i < furDensity.size(); ++i) {
+            float topHeight = (float)(i + 1) / furDensity.size();
+            if (furDensity[i].emptyTileFraction(FUR_ALPHA_CUTOFF / (1.0f - topHeight * 0.5f)) >= EMPTY_TILE_MIN_FRACTION)
+                return true;
+        }
+        return false;
+    }
+
+    // sub-pixel offset of the projection, Halton(2, 3) over 8 frames, in pixels.
+    static glm::vec2 taaJitter(unsigned int index)
+    {
+        auto halton = [](unsigned int i, unsigned int base) {
+            float f = 1.0f, r = 0.0f;
+            for (; i > 0; i /= base) {
+                f /= base;
+                r += f * (i % base);
+            }
+            return r;
+        };
+        unsigned int i = index % 8 + 1;
+        return glm::vec2(halton(i, 2), halton(i, 3)) - 0.5f;
+    }
+
+    // which of every stride shells is drawn this frame. The phase walks through all of them every
+    // stride frames, starting from a scrambled offset so the pattern doesn't lock onto the jitter.
+    int shellPhase(int stride) const
+    {
+        unsigned int cycle = temporalIndex / stride;
+        unsigned int scramble = (cycle * 2654435761u) >> 16;
+        return (int)((temporalIndex + scramble) % stride);
+    }
+
+    // draw shells [first, last) of one object, the fur program and sphere VAO must be bound. Only
+    // every stride-th shell of the LOD and shell subset is drawn (the base layer always is), each
+    // one standing in for stride shells of opacity. outsideIn starts at the outermost shell.
+    void drawShells(const FrameSnapshot& frame, int index, int first, int last, bool outsideIn = false)
+    {
+        const ObjectState& object = frame.objects[index];
+        const ShellTable& table = shellTable(object.fur);
+        last = std::min(last, furLayerLimit(table));
+        // a still object draws the shells above its base layer from its cache, with the program
+        // that only projects them.
+        ShellCache* cache = first > 0 && shellCacheFrame ? shellCache(index, object, table) : nullptr;
+        Shader* sceneShader = shader;
+        if (cache) {
+            shader = cachedShader;
+            state.useProgram(shader->ID);
+            state.bindVertexArray(cache->vao);
+        }
+        int stride = lods[index].stride;
+        float fade = lods[index].fade;
+        int phase = 0;
+        int drawn = object.fur.shellLayers / stride;
+        if (temporalFrame && settings.shellSubset < drawn) {
+            // the rotating subset already hides the steps between levels, no crossfade on top.
+            stride *= std::max(1, drawn / settings.shellSubset);
+            fade = 1.0f;
+            phase = shellPhase(stride);
+        }
+
+        shader->setVec3("objectColor", object.fur.color);
+        shader->setFloat("furLength", object.fur.length);
+        shader->setMat4("model", object.model);
+        shader->setFloat("lodFade", fade);
+        if (temporalFrame)
+            shader->setMat4("prevModel", historyValid ? previousModels[index] : object.model);
+        bool fineOnly = false;
+        shader->setBool("lodFineOnly", false);
+        bool emptyTiles = false;
+        shader->setBool("emptyTiles", false);
+        // the base layer is told apart by index, the lowest shells of a root spacing sit at height ~0 too.
+        bool baseLayer = false;
+        shader->setBool("isBaseLayer", false);
+        // inside the base layer the stencil holds the object's base value + how many drawn shells
+        // still had fur in the pixel, a shell only passes where all shells below it did. Density
+        // never grows towards the tip, so a pixel that lost its fur stays without it.
+        int alive = 1;
+        int batchScope = -1;
+        int batch = -1;
+        for (int n = first; n < last; ++n) {
+            int i = outsideIn ? first + last - 1 - n : n;
+            if (i / SHELL_BATCH != batch && i / SHELL_BATCH < (int)shellBatchNames.size()) {
+                profiler.endScope(batchScope);
+                batch = i / SHELL_BATCH;
+                batchScope = profiler.beginScope(shellBatchNames[batch]);
+            }
+            if (i > 0 && i % stride != phase)
+                continue;
+            if (fade < 1.0f && fineOnly != (i % (2 * stride) != 0)) {
+                fineOnly = !fineOnly;
+                shader->setBool("lodFineOnly", fineOnly);
+            }
+            float shellHeight = table.heights[i];
+            shader->setFloat("shellHeight", shellHeight);
+            if ((i == 0) != baseLayer) {
+                baseLayer = i == 0;
+                shader->setBool("isBaseLayer", baseLayer);
+            }
+            // the shell covers the fur up to the next drawn one, in the coarser LOD level up to the one after.
+            shader->setFloat("shellAlphaPower", table.power(i, stride));
+            if (fade < 1.0f)
+                shader->setFloat("lodCoarsePower", table.power(i, 2 * stride));
+            // the tile test costs a texture fetch, it is only worth it when enough tiles are empty.
+            int texIndex = densityLevel(furDensity.size(), shellHeight);
+            float cutoff = FUR_ALPHA_CUTOFF / (1.0f - shellHeight * 0.5f);
+            bool tiles = i > 0 && furDensity[texIndex].emptyTileFraction(cutoff) >= EMPTY_TILE_MIN_FRACTION;
+            if (tiles)
+                state.bindTexture(TILE_CEILING_UNIT, GL_TEXTURE_2D, furDensity[texIndex].ceiling);
+            if (tiles != emptyTiles) {
+                emptyTiles = tiles;
+                shader->setBool("emptyTiles", emptyTiles);
+            }
+            if (stencilCulling) {
+                // a shell of only the finer LOD level also discards for the dither, that doesn't end the fur.
+                state.stencilFunc(GL_LEQUAL, stencilRef + std::min(alive - 1, stencilRange - 1));
+                state.stencilOp(GL_KEEP, GL_KEEP, fineOnly ? GL_KEEP : GL_INCR);
+            }
+
+            if (cache) {
+                glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, i * sphereVertexCount);
+                ++cachedShellDraws;
+            } else {
+                drawSphere();
+            }
+            if (i > 0)
+                ++shellDraws;
+            if (stencilCulling && !fineOnly)
+                ++alive;
+        }
+        profiler.endScope(batchScope);
+        if (cache) {
+            shader = sceneShader;
+            state.useProgram(shader->ID);
+            state.bindVertexArray(VAO);
+        }
+    }
+
+    // shells from this one up have no texel that reaches the discard threshold, fur density only
+    // goes down towards the tip so none of them would leave a fragment.
+    int furLayerLimit(const ShellTable& table) const
+    {
+        if (!settings.layerCutoff)
+            return table.layers;
+        for (int i = 1; i < table.layers; ++i) {
+            float shellHeight = table.heights[i];
+            // a little below the cutoff so rounding on the GPU can't bring back a fragment.
+            if (densityMax(shellHeight) * (1.0f - shellHeight * 0.5f) < FUR_ALPHA_CUTOFF * 0.99f)
+                return i;
+        }
+        return table.layers;
+    }
+
+    // largest texel a shell at height can sample, the volume blends the two slices around it.
+    float densityMax(float height) const
+    {
+        if (furData == FurData::Volume) {
+            int below = glm::clamp((int)std::floor(height * FUR_VOLUME_DEPTH - 0.5f), 0, FUR_VOLUME_DEPTH - 1);
+            int above = std::min(below + 1, FUR_VOLUME_DEPTH - 1);
+            return std::max(furDensity[below].maxValue, furDensity[above].maxValue);
+        }
+        return furDensity[densityLevel(furDensity.size(), height)].maxValue;
+    }
+
+    // whether the fur of object index is ray-marched this frame. The temporal path needs motion
+    // vectors, which only the shell program writes.
+    bool rayMarched(const FrameSnapshot& frame, int index) const
+    {
+        if (temporalFrame)
+            return false;
+        if (settings.rayMarch)
+            return true;
+        return settings.rayMarchDistance > 0.0f &&
+               glm::length(glm::vec3(frame.objects[index].model[3]) - frame.cameraPosition) >= settings.rayMarchDistance;
+    }
+
+    // everything above the base layer of one object.
+    void drawFur(const FrameSnapshot& frame, int index)
+    {
+        if (rayMarched(frame, index))
+            drawMarched(frame, index);
+        else
+            drawShells(frame, index, 1, frame.objects[index].fur.shellLayers);
+    }
+
+    // one hull at the top of the fur, fur_march.frag walks the ray down through the shell table's
+    // layers. Leaves the fur program bound again.
+    void drawMarched(const FrameSnapshot& frame, int index)
+    {
+        const ObjectState& object = frame.objects[index];
+        const ShellTable& table = shellTable(object.fur);
+        int limit = furLayerLimit(table);
+        int scope = profiler.beginScope("ray march");
+        state.useProgram(marchShader->ID);
+        marchShader->setMat4("view", frame.view);
+        marchShader->setMat4("projection", frameProjection);
+        marchShader->setVec3("cameraPos", frame.cameraPosition);
+        marchShader->setVec3("objectColor", object.fur.color);
+        marchShader->setMat4("model", object.model);
+        marchShader->setFloat("furLength", object.fur.length);
+        marchShader->setFloat("marchLength", object.fur.length * glm::length(glm::vec3(object.model[0])));
+        marchShader->setFloat("shellHeight", table.heights[limit]);
+        if (marchTable != &table || marchLimit != limit) {
+            std::vector<glm::vec2> layers(limit);
+            for (int i = 0; i < limit; ++i)
+                layers[i] = glm::vec2(table.heights[i], table.power(i, 1));
+            marchShader->setVec2Array("marchLayers", layers.data(), limit);
+            marchShader->setInt("marchSteps", limit);
+            marchTable = &table;
+            marchLimit = limit;
+        }
+        drawSphere();
+        state.useProgram(shader->ID);
+        profiler.endScope(scope);
+    }
+
+    // shell table of fur, built the first time its layer count and spacing come up.
+    const ShellTable& shellTable(const FurParams& fur)
+    {
+        for (const ShellTable& table : shellTables)
+            if (table.layers == fur.shellLayers && table.spacing == fur.spacing)
+                return table;
+        shellTables.push_back(buildShellTable(fur.shellLayers, fur.spacing, furDensity));
+        return shellTables.back();
+    }
+
+    // first stencil value of the object at position of the back to front order. Each object counts
+    // in a range of its own, farther objects higher, and the clear value 0xFF stays above all of
+    // them: a shell's test (stencil >= count) then passes on the background and on the pixels of
+    // every object drawn before it, whose counts lie above its own range.
+    static int stencilBase(int position, int count)
+    {
+        return 1 + (count - 1 - position) * (254 / count);
+    }
+
+    // shells of all objects back to front with the stencil counting shells that still have fur. Only
+    // pixels of the object's base layer are counted: every shell covers those, outside them the
+    // larger outer shells reach pixels the inner ones never touched. The base pass wrote each
+    // object's start value, so the stencil is cleared once per frame. A count that reaches the end
+    // of the object's range stops culling, nearer objects' shells would otherwise be rejected there.
+    void drawStencilCulled(const FrameSnapshot& frame, const glm::mat4& projection)
+    {
+        Shader* sceneShader = shader;
+        shader = stencilShader;
+        state.useProgram(shader->ID);
+        shader->setMat4("view", frame.view);
+        shader->setMat4("projection", projection);
+        state.setStencilTest(true);
+        stencilRange = 254 / frame.objectCount;
+        for (int i = 0; i < frame.objectCount; ++i) {
+            stencilRef = stencilBase(i, frame.objectCount);
+            stencilCulling = true;
+            drawShells(frame, drawOrder[i], 1, frame.objects[drawOrder[i]].fur.shellLayers);
+            stencilCulling = false;
+        }
+        state.setStencilTest(false);
+        shader = sceneShader;
+        state.useProgram(shader->ID);
+    }
+
+    // depth of every opaque base layer with a program that shades nothing, leaves shader bound again.
+    void drawDepthPrepass(const FrameSnapshot& frame, const glm::mat4& projection)
+    {
+        ProfileScope scope(profiler, "depth prepass");
+        state.useProgram(depthShader->ID);
+        depthShader->setMat4("view", frame.view);
+        depthShader->setMat4("projection", projection);
+        depthShader->setFloat("shellHeight", 0.0f);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        for (int o = 0; o < frame.objectCount; ++o) {
+            depthShader->setFloat("furLength", frame.objects[o].fur.length);
+            depthShader->setMat4("model", frame.objects[o].model);
+            drawSphere();
+        }
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        state.useProgram(shader->ID);
+    }
+
+    // (re)create target when its size changed, returns false if it is incomplete.
+    bool ensureTarget(Framebuffer& target, int width, int height, GLenum format, GLenum secondFormat = GL_NONE, int samples = 0)
+    {
+        if (target.FBO && target.width == width && target.height == height)
+            return true;
+        bool complete = target.create(width, height, format, secondFormat, samples);
+        state.invalidate();
+        return complete;
+    }
+
+    // size the targets of the scaled fur pass, falls back to full resolution if they can't be created.
+    bool prepareScaledTargets(int width, int height)
+    {
+        int furWidth = std::max(1, (int)(width * settings.furScale + 0.5f));
+        int furHeight = std::max(1, (int)(height * settings.furScale + 0.5f));
+        if (ensureTarget(depthGuide, width, height, GL_NONE) && ensureTarget(furTarget, furWidth, furHeight, GL_RGBA16F))
+            return true;
+        std::cout << "ERROR::FUR_RENDERER:: scaled fur targets unavailable, rendering at full resolution" << std::endl;
+        settings.furScale = 1.0f;
+        return false;
+    }
+
+    bool prepareCoverageTarget(int width, int height)
+    {
+        if (ensureTarget(coverageTarget, width, height, GL_RGBA8, GL_NONE, MSAA_SAMPLES)
+            && ensureTarget(coverageResolve, width, height, GL_RGBA8))
+            return true;
+        std::cout << "ERROR::FUR_RENDERER:: " << MSAA_SAMPLES << "x MSAA target unavailable, blending shells instead" << std::endl;
+        settings.alphaToCoverage = false;
+        return false;
+    }
+
+    bool prepareOitTarget(int width, int height)
+    {
+        if (ensureTarget(oitTarget, width, height, GL_RGBA16F, GL_R16F))
+            return true;
+        std::cout << "ERROR::FUR_RENDERER:: OIT target unavailable, sorting objects instead" << std::endl;
+        settings.oit = false;
+        return false;
+    }
+
+    // targets of the temporal pass, a resize throws the history away.
+    bool prepareTemporalTargets(int width, int height)
+    {
+        bool resized = sceneTarget.width != width || sceneTarget.height != height;
+        if (ensureTarget(sceneTarget, width, height, GL_RGBA16F, GL_RG16F) &&
+            ensureTarget(historyTargets[0], width, height, GL_RGBA16F) &&
+            ensureTarget(historyTargets[1], width, height, GL_RGBA16F)) {
+            if (resized)
+                historyValid = false;
+            return true;
+        }
+        std::cout << "ERROR::FUR_RENDERER:: temporal targets unavailable, drawing every shell" << std::endl;
+        settings.shellSubset = 0;
+        return false;
+    }
+
+    // blend the current frame into the reprojected, neighbourhood clamped history and copy the
+    // result into targetFBO.
+    void resolveTemporal(GLuint targetFBO, int width, int height)
+    {
+        ProfileScope scope(profiler, "temporal resolve");
+        Framebuffer& history = historyTargets[historyIndex];
+        Framebuffer& resolved = historyTargets[1 - historyIndex];
+        state.bindFramebuffer(resolved.FBO);
+        state.viewport(0, 0, width, height);
+        state.useProgram(taaShader->ID);
+        taaShader->setFloat("feedback", historyValid ? TAA_FEEDBACK : 0.0f);
+        state.bindTexture(TAA_CURRENT_UNIT, GL_TEXTURE_2D, sceneTarget.colorTexture);
+        state.bindTexture(TAA_VELOCITY_UNIT, GL_TEXTURE_2D, sceneTarget.auxTexture);
+        state.bindTexture(TAA_HISTORY_UNIT, GL_TEXTURE_2D, history.colorTexture);
+        state.setDepthTest(false);
+        state.setBlend(false);
+        state.bindVertexArray(emptyVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        state.setBlend(true);
+        state.setDepthTest(true);
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, resolved.FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFBO);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        // the blit split read and draw bindings, put both back on the target.
+        state.bindFramebuffer(targetFBO);
+
+        historyIndex = 1 - historyIndex;
+        historyValid = true;
+    }
+
+    // shells as opaque geometry in a multisampled target, alpha only decides how many samples a
+    // fragment covers. Nothing is blended, so all of it is drawn front to back for the depth test:
+    // nearest object first, outermost shell first, the base layer last.
+    void renderCoverage(const FrameSnapshot& frame, const glm::mat4& projection, GLuint sceneFBO, int width, int height)
+    {
+        {
+            ProfileScope scope(profiler, "fur coverage");
+            state.bindFramebuffer(coverageTarget.FBO);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            Shader* sceneShader = shader;
+            shader = coverageShader;
+            state.useProgram(shader->ID);
+            shader->setMat4("view", frame.view);
+            shader->setMat4("projection", projection);
+            state.setBlend(false);
+            state.setAlphaToCoverage(true);
+            for (int i = frame.objectCount - 1; i >= 0; --i)
+                drawShells(frame, drawOrder[i], 0, frame.objects[drawOrder[i]].fur.shellLayers, true);
+            state.setAlphaToCoverage(false);
+            state.setBlend(true);
+            shader = sceneShader;
+            state.useProgram(shader->ID);
+        }
+        {
+            // a multisample blit needs the same format on both sides, which the default framebuffer
+            // (sRGB, RGB10_A2, ...) doesn't promise. The samples go into an RGBA8 target first, the
+            // single-sample copy into sceneFBO may convert.
+            ProfileScope scope(profiler, "msaa resolve");
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, coverageTarget.FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, coverageResolve.FBO);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, coverageResolve.FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, sceneFBO);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            state.bindFramebuffer(sceneFBO);
+        }
+    }
+
+    // weighted blended OIT: the shells of all objects in any order into accumulation and revealage,
+    // tested against their own copy of the base depth, then resolved over the base layers in sceneFBO.
+    void renderOit(const FrameSnapshot& frame, const glm::mat4& projection, GLuint sceneFBO)
+    {
+        state.bindFramebuffer(oitTarget.FBO);
+        static const GLfloat empty[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        static const GLfloat clear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glClearBufferfv(GL_COLOR, 0, empty);
+        glClearBufferfv(GL_COLOR, 1, clear);
+        state.depthMask(true);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        drawDepthPrepass(frame, projection);
+        state.depthMask(false);
+
+        {
+            ProfileScope scope(profiler, "fur oit");
+            Shader* sceneShader = shader;
+            shader = oitShader;
+            state.useProgram(shader->ID);
+            shader->setMat4("view", frame.view);
+            shader->setMat4("projection", projection);
+            state.blendFunci(0, GL_ONE, GL_ONE);
+            state.blendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+            for (int o = 0; o < frame.objectCount; ++o)
+                drawShells(frame, o, 1, frame.objects[o].fur.shellLayers);
+            shader = sceneShader;
+        }
+        {
+            ProfileScope scope(profiler, "oit resolve");
+            state.bindFramebuffer(sceneFBO);
+            state.useProgram(oitResolveShader->ID);
+            state.bindTexture(OIT_ACCUMULATION_UNIT, GL_TEXTURE_2D, oitTarget.colorTexture);
+            state.bindTexture(OIT_REVEALAGE_UNIT, GL_TEXTURE_2D, oitTarget.auxTexture);
+            state.setDepthTest(false);
+            state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            state.bindVertexArray(emptyVAO);
+            // the resolve has no motion vectors, keep the ones of the base layer.
+            if (temporalFrame)
+                glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (temporalFrame)
+                glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            state.setDepthTest(true);
+            state.bindVertexArray(VAO);
+            state.useProgram(shader->ID);
+        }
+    }
+
+    // opaque base layer at full resolution, shells into the smaller furTarget and a joint bilateral
+    // upsample guided by the base layer depth composited on top.
+    void renderScaled(const FrameSnapshot& frame, GLuint targetFBO, int width, int height)
+    {
+        int furWidth = furTarget.width;
+        int furHeight = furTarget.height;
+        {
+            ProfileScope scope(profiler, "base");
+            state.bindFramebuffer(targetFBO);
+            state.viewport(0, 0, width, height);
+            for (int o = 0; o < frame.objectCount; ++o)
+                drawShells(frame, o, 0, 1);
+            // the same depth once more into a texture, the default framebuffer can't be sampled.
+            state.bindFramebuffer(depthGuide.FBO);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            for (int o = 0; o < frame.objectCount; ++o)
+                drawShells(frame, o, 0, 1);
+        }
+        {
+            ProfileScope scope(profiler, "fur");
+            // the low resolution depth is point sampled from the guide so both sides of the upsample agree.
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, depthGuide.FBO);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, furTarget.FBO);
+            glBlitFramebuffer(0, 0, width, height, 0, 0, furWidth, furHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            state.bindFramebuffer(furTarget.FBO);
+            state.viewport(0, 0, furWidth, furHeight);
+            glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            // premultiplied color and accumulated coverage; shells only test depth so the guide stays the base layer.
+            state.blendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            state.depthMask(false);
+            for (int i = 0; i < frame.objectCount; ++i)
+                drawFur(frame, drawOrder[i]);
+            state.depthMask(true);
+        }
+        {
+            ProfileScope scope(profiler, "upsample");
+            state.bindFramebuffer(targetFBO);
+            state.viewport(0, 0, width, height);
+            state.useProgram(upsampleShader->ID);
+            state.bindTexture(UPSAMPLE_COLOR_UNIT, GL_TEXTURE_2D, furTarget.colorTexture);
+            state.bindTexture(UPSAMPLE_DEPTH_UNIT, GL_TEXTURE_2D, furTarget.depthTexture);
+            state.bindTexture(UPSAMPLE_SCENE_DEPTH_UNIT, GL_TEXTURE_2D, depthGuide.depthTexture);
+            state.setDepthTest(false);
+            state.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            state.bindVertexArray(emptyVAO);
+            // the composite has no motion vectors, keep the ones of the base layer.
+            if (temporalFrame)
+                glColorMaski(1, GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (temporalFrame)
+                glColorMaski(1, GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            state.setDepthTest(true);
+            state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        }
+    }
+};
+#endif
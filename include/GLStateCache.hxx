@@ -0,0 +1,261 @@
+#ifndef _GL_STATE_CACHE_HXX_
+#define _GL_STATE_CACHE_HXX_
+
+#include <glad/glad.h>
+
+#include <iostream>
+
+// Shadow copy of the GL state the renderer touches every frame. Calls that would set a value the
+// context already has are dropped. Anything that changes this state behind the cache's back
+// (e.g. creating textures or framebuffers) must be followed by invalidate().
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    GLStateCache()
+    {
+        invalidate();
+        resetCounters();
+    }
+
+    // forget everything, the next call of every kind goes through.
+    void invalidate()
+    {
+        program = UNKNOWN;
+        vertexArray = UNKNOWN;
+        framebuffer = UNKNOWN;
+        activeUnit = UNKNOWN;
+        for (int i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        {
+            textureTargets[i] = UNKNOWN;
+            textures[i] = UNKNOWN;
+            samplers[i] = UNKNOWN;
+        }
+        blend = depthTest = depthWrite = alphaToCoverage = stencilTest = UNKNOWN;
+        stencilFunction = stencilRef = stencilFail = stencilDepthFail = stencilPass = stencilClear = UNKNOWN;
+        blendSrc = blendDst = blendSrcAlpha = blendDstAlpha = depthFunction = UNKNOWN;
+        viewportX = viewportY = viewportWidth = viewportHeight = -1;
+    }
+
+    void useProgram(GLuint id)
+    {
+        if (changed(program, id))
+            glUseProgram(id);
+    }
+
+    void bindVertexArray(GLuint vao)
+    {
+        if (changed(vertexArray, vao))
+            glBindVertexArray(vao);
+    }
+
+    void bindFramebuffer(GLuint fbo)
+    {
+        if (changed(framebuffer, fbo))
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    }
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+    {
+        ++requested;
+        if (x == viewportX && y == viewportY && width == viewportWidth && height == viewportHeight)
+            return;
+        viewportX = x;
+        viewportY = y;
+        viewportWidth = width;
+        viewportHeight = height;
+        ++issued;
+        glViewport(x, y, width, height);
+    }
+
+    // binds texture to unit, only switches the active unit when a bind is actually needed.
+    void bindTexture(GLuint unit, GLenum target, GLuint texture)
+    {
+        ++requested;
+        if (unit < (GLuint)MAX_TEXTURE_UNITS && textureTargets[unit] == target && textures[unit] == texture)
+            return;
+        activeTexture(unit);
+        ++issued;
+        glBindTexture(target, texture);
+        if (unit < (GLuint)MAX_TEXTURE_UNITS)
+        {
+            textureTargets[unit] = target;
+            textures[unit] = texture;
+        }
+    }
+
+    // sampler object of unit, 0 goes back to the texture's own sampling parameters.
+    void bindSampler(GLuint unit, GLuint sampler)
+    {
+        if (unit >= (GLuint)MAX_TEXTURE_UNITS)
+        {
+            glBindSampler(unit, sampler);
+            return;
+        }
+        if (changed(samplers[unit], sampler))
+            glBindSampler(unit, sampler);
+    }
+
+    void setBlend(bool enabled)
+    {
+        toggle(blend, enabled, GL_BLEND);
+    }
+
+    void blendFunc(GLenum src, GLenum dst)
+    {
+        blendFuncSeparate(src, dst, src, dst);
+    }
+
+    void blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
+    {
+        ++requested;
+        if (blendSrc == srcRGB && blendDst == dstRGB && blendSrcAlpha == srcAlpha && blendDstAlpha == dstAlpha)
+            return;
+        blendSrc = srcRGB;
+        blendDst = dstRGB;
+        blendSrcAlpha = srcAlpha;
+        blendDstAlpha = dstAlpha;
+        ++issued;
+        glBlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+    }
+
+    // blend function of one draw buffer, the cached shared function is unknown afterwards.
+    void blendFunci(GLuint buffer, GLenum src, GLenum dst)
+    {
+        ++requested;
+        ++issued;
+        glBlendFunci(buffer, src, dst);
+        blendSrc = blendDst = blendSrcAlpha = blendDstAlpha = UNKNOWN;
+    }
+
+    void setAlphaToCoverage(bool enabled)
+    {
+        toggle(alphaToCoverage, enabled, GL_SAMPLE_ALPHA_TO_COVERAGE);
+    }
+
+    void setDepthTest(bool enabled)
+    {
+        toggle(depthTest, enabled, GL_DEPTH_TEST);
+    }
+
+    void depthMask(bool enabled)
+    {
+        if (changed(depthWrite, enabled ? GL_TRUE : GL_FALSE))
+            glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+    }
+
+    void depthFunc(GLenum func)
+    {
+        if (changed(depthFunction, func))
+            glDepthFunc(func);
+    }
+
+    void setStencilTest(bool enabled)
+    {
+        toggle(stencilTest, enabled, GL_STENCIL_TEST);
+    }
+
+    // stencil test against ref with all bits.
+    void stencilFunc(GLenum func, GLint ref)
+    {
+        ++requested;
+        if (stencilFunction == func && stencilRef == (GLuint)ref)
+            return;
+        stencilFunction = func;
+        stencilRef = (GLuint)ref;
+        ++issued;
+        glStencilFunc(func, ref, 0xFF);
+    }
+
+    void stencilOp(GLenum fail, GLenum depthFail, GLenum pass)
+    {
+        ++requested;
+        if (stencilFail == fail && stencilDepthFail == depthFail && stencilPass == pass)
+            return;
+        stencilFail = fail;
+        stencilDepthFail = depthFail;
+        stencilPass = pass;
+        ++issued;
+        glStencilOp(fail, depthFail, pass);
+    }
+
+    // value glClear writes into the stencil buffer.
+    void clearStencil(GLint value)
+    {
+        if (changed(stencilClear, (GLuint)value))
+            glClearStencil(value);
+    }
+
+    unsigned long long requestedCalls() const
+    {
+        return requested;
+    }
+
+    unsigned long long filteredCalls() const
+    {
+        return requested - issued;
+    }
+
+    void resetCounters()
+    {
+        requested = 0;
+        issued = 0;
+    }
+
+    void printStats(unsigned long long frames) const
+    {
+        std::cout << "state cache: " << requested << " state calls, " << filteredCalls() << " filtered";
+        if (requested)
+            std::cout << " (" << (100.0 * filteredCalls() / requested) << "%)";
+        if (frames)
+            std::cout << ", " << (double)issued / frames << " issued per frame";
+        std::cout << std::endl;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint framebuffer;
+    GLuint activeUnit;
+    GLenum textureTargets[MAX_TEXTURE_UNITS];
+    GLuint textures[MAX_TEXTURE_UNITS];
+    GLuint samplers[MAX_TEXTURE_UNITS];
+    GLuint blend, depthTest, depthWrite, alphaToCoverage, stencilTest;
+    GLenum stencilFunction, stencilFail, stencilDepthFail, stencilPass;
+    GLuint stencilRef, stencilClear;
+    GLenum blendSrc, blendDst, blendSrcAlpha, blendDstAlpha, depthFunction;
+    GLint viewportX, viewportY, viewportWidth, viewportHeight;
+    unsigned long long requested;
+    unsigned long long issued;
+
+    // counts the request and records the new value, returns true if GL has to be called.
+    bool changed(GLuint& current, GLuint value)
+    {
+        ++requested;
+        if (current == value)
+            return false;
+        current = value;
+        ++issued;
+        return true;
+    }
+
+    void activeTexture(GLuint unit)
+    {
+        if (changed(activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    void toggle(GLuint& current, bool enabled, GLenum capability)
+    {
+        if (!changed(current, enabled ? 1u : 0u))
+            return;
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+    }
+};
+#endif
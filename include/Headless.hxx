@@ -0,0 +1,94 @@
+#ifndef _HEADLESS_HXX_
+#define _HEADLESS_HXX_
+
+#ifdef FUR_HAS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+
+// OpenGL context without a window or display server.
+// Prefers the Mesa surfaceless platform (works with llvmpipe on plain servers) and falls back to
+// the default EGL display. No surface is made current, rendering has to go into a framebuffer object.
+class HeadlessContext
+{
+public:
+    HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT) {}
+
+    bool create(int major, int minor)
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint eglMajor, eglMinor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+        {
+            std::cout << "ERROR::EGL:: no display available (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "ERROR::EGL:: desktop OpenGL is not supported" << std::endl;
+            return false;
+        }
+
+        // a config is only needed to pick a GL capable one, nothing is ever drawn to an EGL surface.
+        const EGLint configAttribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config = NULL;
+        EGLint numConfigs = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, major,
+            EGL_CONTEXT_MINOR_VERSION, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, numConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT)
+        {
+            std::cout << "ERROR::EGL:: failed to create a " << major << "." << minor << " core context (0x"
+                      << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "ERROR::EGL:: surfaceless eglMakeCurrent failed (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        std::cout << "EGL " << eglMajor << "." << eglMinor << " (" << eglQueryString(display, EGL_VENDOR) << ")" << std::endl;
+        return true;
+    }
+
+    // for gladLoadGLLoader.
+    static void* getProcAddress(const char* name)
+    {
+        return (void*)eglGetProcAddress(name);
+    }
+
+    void release()
+    {
+        if (display == EGL_NO_DISPLAY)
+            return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT)
+            eglDestroyContext(display, context);
+        eglTerminate(display);
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+    }
+
+private:
+    EGLDisplay display;
+    EGLContext context;
+};
+#endif
+#endif
@@ -0,0 +1,153 @@
+#ifndef _IMAGE_HXX_
+#define _IMAGE_HXX_
+
+#include <glad/glad.h>
+// Model.hxx compiles the stb_image implementation, including it again after that would duplicate it.
+#ifndef STBI_INCLUDE_STB_IMAGE_H
+#include <stb_image.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// 8-bit RGBA image, rows stored top to bottom.
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    unsigned char* at(int x, int y)
+    {
+        return &pixels[((size_t)y * width + x) * 4];
+    }
+    const unsigned char* at(int x, int y) const
+    {
+        return &pixels[((size_t)y * width + x) * 4];
+    }
+};
+
+// read the color attachment of fbo, flipped to top-down row order. Alpha is forced to opaque since
+// it only holds blending leftovers, the window shows the color channels as they are.
+inline Image readFramebuffer(GLuint fbo, int width, int height)
+{
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t)width * height * 4);
+    std::vector<unsigned char> rows(image.pixels.size());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+    size_t stride = (size_t)width * 4;
+    for (int y = 0; y < height; ++y)
+        std::copy(rows.begin() + (height - 1 - y) * stride, rows.begin() + (height - y) * stride, image.pixels.begin() + y * stride);
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+        image.pixels[i] = 255;
+    return image;
+}
+
+inline bool loadPng(const std::string& path, Image& image)
+{
+    // the global flip flag is meant for model textures, images here are always top-down.
+    stbi_set_flip_vertically_on_load(false);
+    int channels;
+    unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+    stbi_set_flip_vertically_on_load(true);
+    if (!data)
+        return false;
+    image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+// minimal PNG encoder: RGBA8, zlib stream made of uncompressed (stored) deflate blocks.
+// Files are bigger than a real encoder would produce but it needs no extra dependency.
+inline bool writePng(const std::string& path, const Image& image)
+{
+    static uint32_t crcTable[256];
+    static bool crcReady = false;
+    if (!crcReady)
+    {
+        for (uint32_t n = 0; n < 256; ++n)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+        crcReady = true;
+    }
+
+    auto put32 = [](std::vector<unsigned char>& out, uint32_t v) {
+        out.push_back((v >> 24) & 0xFF);
+        out.push_back((v >> 16) & 0xFF);
+        out.push_back((v >> 8) & 0xFF);
+        out.push_back(v & 0xFF);
+    };
+    auto chunk = [&](std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+        put32(out, (uint32_t)data.size());
+        size_t start = out.size();
+        out.insert(out.end(), type, type + 4);
+        out.insert(out.end(), data.begin(), data.end());
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = start; i < out.size(); ++i)
+            crc = crcTable[(crc ^ out[i]) & 0xFF] ^ (crc >> 8);
+        put32(out, crc ^ 0xFFFFFFFFu);
+    };
+
+    // scanlines with filter type 0.
+    std::vector<unsigned char> raw;
+    size_t stride = (size_t)image.width * 4;
+    raw.reserve((stride + 1) * image.height);
+    for (int y = 0; y < image.height; ++y)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), image.pixels.begin() + y * stride, image.pixels.begin() + (y + 1) * stride);
+    }
+
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    const size_t BLOCK = 65535;
+    for (size_t pos = 0; pos < raw.size() || pos == 0; pos += BLOCK)
+    {
+        size_t len = std::min(BLOCK, raw.size() - pos);
+        zlib.push_back(pos + len >= raw.size() ? 1 : 0);
+        zlib.push_back(len & 0xFF);
+        zlib.push_back((len >> 8) & 0xFF);
+        zlib.push_back(~len & 0xFF);
+        zlib.push_back((~len >> 8) & 0xFF);
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + len);
+        if (raw.empty())
+            break;
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw)
+    {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put32(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> header;
+    put32(header, (uint32_t)image.width);
+    put32(header, (uint32_t)image.height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });     // 8 bit, RGBA, deflate, no filter, no interlace.
+
+    std::vector<unsigned char> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    chunk(file, "IHDR", header);
+    chunk(file, "IDAT", zlib);
+    chunk(file, "IEND", std::vector<unsigned char>());
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        std::cout << "ERROR::IMAGE:: can't write " << path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+    return true;
+}
+#endif
@@ -0,0 +1,191 @@
+#ifndef _IMAGE_TEST_HXX_
+#define _IMAGE_TEST_HXX_
+
+#include <glad/glad.h>
+
+#include <FurRenderer.hxx>
+#include <Framebuffer.hxx>
+#include <Image.hxx>
+#include <Simulation.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// golden images are rendered at a fixed size so they stay comparable across machines.
+const int IMAGE_TEST_WIDTH = 320;
+const int IMAGE_TEST_HEIGHT = 240;
+// per-pixel YIQ color distance (1 between black and white) that still counts as equal, the fur is
+// dark so this has to be much tighter than the usual 0.1.
+const float IMAGE_TEST_COLOR_THRESHOLD = 0.03f;
+
+// a fixed scene: the simulation is advanced by a number of fixed steps from its initial state.
+struct ImageTestScene {
+    const char* name;
+    int steps;
+    bool scriptedCamera;
+};
+
+const ImageTestScene IMAGE_TEST_SCENES[] = {
+    { "front",        1,    false },    // initial camera, base layer and all shells face on.
+    { "rotated",      600,  false },    // 5 s of object rotation.
+    { "orbit_close",  1,    true },     // closest point of the scripted path, highest overdraw.
+    { "orbit_side",   600,  true },     // scripted camera from the side, grazing shells on the silhouette.
+};
+
+struct ImageDiff {
+    int failedPixels = 0;
+    double failedFraction = 0.0;
+    float maxDistance = 0.0f;
+    Image diff;
+};
+
+// squared YIQ distance of two colors, 1 between black and white. The weights follow the
+// perceptual metric used by pixelmatch (Kotsarenko & Ramos).
+inline float colorDistance(const unsigned char* a, const unsigned char* b)
+{
+    float r = (a[0] - b[0]) / 255.0f, g = (a[1] - b[1]) / 255.0f, bl = (a[2] - b[2]) / 255.0f;
+    float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+    float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+    float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+    return (0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q) / 0.5053f;
+}
+
+// 3x3 box filtered copy, the local average color of a pixel.
+inline Image boxFilter(const Image& image)
+{
+    Image out = image;
+    for (int y = 0; y < image.height; ++y)
+        for (int x = 0; x < image.width; ++x)
+            for (int c = 0; c < 3; ++c)
+            {
+                int sum = 0;
+                for (int dy = -1; dy <= 1; ++dy)
+                    for (int dx = -1; dx <= 1; ++dx)
+                    {
+                        int sx = std::min(std::max(x + dx, 0), image.width - 1);
+                        int sy = std::min(std::max(y + dy, 0), image.height - 1);
+                        sum += image.at(sx, sy)[c];
+                    }
+                out.at(x, y)[c] = (unsigned char)(sum / 9);
+            }
+    return out;
+}
+
+// a pixel fails when its color differs by more than threshold and the local average around it
+// differs by more than half the threshold as well. The second test forgives isolated strand tips
+// that land one pixel off through rasterization or filtering precision (different GPUs, drivers)
+// while anything that changes what the fur looks like in an area is still reported.
+inline ImageDiff compareImages(const Image& actual, const Image& golden, float threshold)
+{
+    ImageDiff result;
+    result.diff.width = actual.width;
+    result.diff.height = actual.height;
+    result.diff.pixels.resize(actual.pixels.size());
+    Image actualAverage = boxFilter(actual);
+    Image goldenAverage = boxFilter(golden);
+    float limit = threshold * threshold;
+    float areaLimit = limit * 0.25f;
+    for (int y = 0; y < actual.height; ++y)
+    {
+        for (int x = 0; x < actual.width; ++x)
+        {
+            float distance = colorDistance(actual.at(x, y), golden.at(x, y));
+            bool failed = distance > limit && colorDistance(actualAverage.at(x, y), goldenAverage.at(x, y)) > areaLimit;
+            result.maxDistance = std::max(result.maxDistance, std::sqrt(distance));
+
+            // faded golden image with failing pixels in red.
+            unsigned char* d = result.diff.at(x, y);
+            const unsigned char* g = golden.at(x, y);
+            unsigned char gray = (unsigned char)(64 + (g[0] + g[1] + g[2]) / 12);
+            d[0] = d[1] = d[2] = gray;
+            d[3] = 255;
+            if (failed)
+            {
+                ++result.failedPixels;
+                d[0] = 255;
+                d[1] = d[2] = 0;
+            }
+        }
+    }
+    result.failedFraction = (double)result.failedPixels / ((double)actual.width * actual.height);
+    return result;
+}
+
+// renders every scene with fur on its objects offscreen and compares it with goldenDir/<scene>.png.
+// A missing golden is a failure, goldens are only ever written with update. Failures write
+// <scene>.actual.png and <scene>.diff.png into outputDir. Returns the number of failed scenes.
+inline int runImageTests(FurRenderer& renderer, const FurParams& fur, const std::string& goldenDir, const std::string& outputDir,
+                         bool update, double tolerance)
+{
+    namespace fs = std::filesystem;
+    Framebuffer target;
+    if (!target.create(IMAGE_TEST_WIDTH, IMAGE_TEST_HEIGHT))
+        return 1;
+    // creating the target changed texture and framebuffer bindings behind the renderer's back.
+    renderer.invalidateState();
+    std::error_code error;
+    fs::create_directories(update ? goldenDir : outputDir, error);
+
+    int failures = 0;
+    for (const ImageTestScene& scene : IMAGE_TEST_SCENES)
+    {
+        Simulation simulation(fur);
+        simulation.setScriptedCamera(scene.scriptedCamera);
+        for (int i = 0; i < scene.steps; ++i)
+            simulation.step(Simulation::FIXED_DT, nullptr);
+        FrameSnapshot frame;
+        simulation.writeSnapshot(frame);
+
+        // temporal modes need a few frames of the still scene to converge.
+        renderer.resetHistory();
+        for (int i = 0; i < renderer.settleFrames(); ++i)
+            renderer.render(frame, target.FBO, target.width, target.height);
+        Image actual = readFramebuffer(target.FBO, target.width, target.height);
+        std::string golden = (fs::path(goldenDir) / (std::string(scene.name) + ".png")).string();
+
+        if (update)
+        {
+            bool written = writePng(golden, actual);
+            std::cout << "image test " << std::left << std::setw(12) << scene.name << std::right
+                      << (written ? " golden written to " : " FAILED to write ") << golden << std::endl;
+            failures += written ? 0 : 1;
+            continue;
+        }
+
+        Image expected;
+        bool passed = false;
+        std::string detail;
+        if (!loadPng(golden, expected))
+            detail = "missing golden " + golden + " (goldens are only written with --update-golden)";
+        else if (expected.width != actual.width || expected.height != actual.height)
+            detail = "golden size " + std::to_string(expected.width) + "x" + std::to_string(expected.height) + " differs";
+        else
+        {
+            ImageDiff diff = compareImages(actual, expected, IMAGE_TEST_COLOR_THRESHOLD);
+            passed = diff.failedFraction <= tolerance;
+            std::ostringstream text;
+            text << diff.failedPixels << " pixels differ (" << std::fixed << std::setprecision(3) << diff.failedFraction * 100.0
+                 << "%, max distance " << diff.maxDistance << ")";
+            detail = text.str();
+            if (!passed)
+                writePng((fs::path(outputDir) / (std::string(scene.name) + ".diff.png")).string(), diff.diff);
+        }
+        if (!passed)
+        {
+            writePng((fs::path(outputDir) / (std::string(scene.name) + ".actual.png")).string(), actual);
+            ++failures;
+        }
+        std::cout << "image test " << std::left << std::setw(12) << scene.name << std::right
+                  << (passed ? " passed: " : " FAILED: ") << detail << std::endl;
+    }
+    target.release();
+    std::cout << "image tests: " << failures << " of " << sizeof(IMAGE_TEST_SCENES) / sizeof(IMAGE_TEST_SCENES[0])
+              << " failed" << std::endl;
+    return failures;
+}
+#endif
@@ -7,6 +7,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <Shader.hxx>
+#include <GLStateCache.hxx>
 
 #include <string>
 #include <vector>
@@ -56,8 +57,9 @@ public:
         setupMesh();
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // render the mesh. Bindings go through the state cache, those already current are skipped and
+    // nothing is reset afterwards, the next draw only changes what it needs.
+    void Draw(Shader &shader, GLStateCache &state)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -66,7 +68,6 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -80,19 +81,15 @@ public:
                 number = std::to_string(heightNr++); // transfer unsigned int to string
 
             // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            shader.setInt(name + number, i);
             // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            state.bindTexture(i, GL_TEXTURE_2D, textures[i].id);
         }
         
         // draw mesh
-        glBindVertexArray(VAO);
+        state.bindVertexArray(VAO);
         //glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
 	glDrawArrays(GL_PATCHES, 0, static_cast<unsigned int>(indices.size()));
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
 private:
@@ -0,0 +1,333 @@
+#ifndef _OPTIONS_HXX_
+#define _OPTIONS_HXX_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <RenderTypes.hxx>
+#include <Simulation.hxx>
+
+// command line settings of the application.
+struct Options {
+    bool profile = false;       // collect CPU/GPU scope timings and print a rolling summary.
+    std::string tracePath;      // write a chrome://tracing / Perfetto JSON file on exit.
+    bool headless = false;      // render offscreen through EGL, no window and no input.
+    int frames = 0;             // frames to render before exiting, 0 renders until the window is closed.
+    int width = 800;
+    int height = 600;
+    bool benchmark = false;     // scripted camera, fixed time step, no vsync, frame time report.
+    std::string benchmarkPath = "benchmark.json";
+    std::string imageTestDir;   // golden image directory, runs the image tests headless and exits.
+    std::string imageTestOutput = "image_test_output";
+    bool updateGolden = false;  // write the goldens instead of comparing.
+    double imageTolerance = 0.002;  // fraction of pixels allowed to differ.
+    float furScale = 1.0f;      // resolution of the fur shell pass relative to the framebuffer.
+    int shellSubset = 0;        // shells per frame with temporal accumulation, 0 draws all.
+    bool shellLod = true;       // fewer shells for objects that are small on screen.
+    bool layerCutoff = true;    // shells above the end of the fur are skipped.
+    bool oit = false;           // order-independent transparency instead of sorted objects.
+    bool alphaToCoverage = false;   // opaque MSAA shells with alpha-to-coverage instead of blending.
+    bool compareCoverage = false;   // time the same frames blended and with alpha-to-coverage, headless.
+    bool stencilCull = false;   // stencil mask of pixels whose fur ended at a lower shell.
+    bool shellCache = false;    // displaced shells of still objects captured once and reused.
+    bool staticScene = false;   // objects don't spin.
+    bool rayMarch = false;      // one ray-marched hull per object instead of shells.
+    float rayMarchDistance = 0.0f;  // ray-march only objects at least this far away, 0 is off.
+    int objects = 1;            // furry spheres in the scene.
+    int shellLayers = 64;       // shells per object.
+    ShellSpacing shellSpacing = ShellSpacing::Linear;
+    FurData furData = FurData::Layers;
+    SphereGeometry sphereGeometry = SphereGeometry::Attributes;
+    double targetFrameMs = 0.0; // GPU frame time the quality governor holds, 0 is off.
+};
+
+inline void printUsage(const char* program)
+{
+    std::cout << "usage: " << program << " [options]\n"
+              << "  --profile            print per-scope CPU/GPU timings every few seconds\n"
+              << "  --trace <file>       write a chrome://tracing JSON trace on exit (implies --profile)\n"
+              << "  --headless           render offscreen without a window (EGL, works on Mesa llvmpipe)\n"
+              << "  --frames <n>         exit after n frames (headless default: 300, benchmark default: 500)\n"
+              << "  --size <w>x<h>       framebuffer size (default 800x600)\n"
+              << "  --benchmark          scripted camera path, fixed time step, vsync off, report frame times\n"
+              << "  --benchmark-out <f>  benchmark JSON report (default benchmark.json)\n"
+              << "  --image-test <dir>   render the fixed test scenes headless and compare with <dir>/<scene>.png\n"
+              << "  --image-test-out <d> where actual and diff images of failed scenes go (default image_test_output)\n"
+              << "  --image-tolerance <f> fraction of pixels that may differ (default 0.002)\n"
+              << "  --update-golden      write the golden images instead of comparing\n"
+              << "  --fur-scale <s>      render the fur shells at s times the resolution (0.5, 0.25), R cycles it\n"
+              << "  --objects <n>        scene with n spheres (up to 16) at increasing distances\n"
+              << "  --fur-data <d>       layers (default, a 2D texture per band of heights), volume (3D texture) or heights (strand height map)\n"
+              << "  --sphere-geometry <g> attributes (default, vertex and index buffers), procedural (from vertex ids) or pulled (packed storage buffers)\n"
+              << "  --no-shell-lod       always draw every shell, L toggles the LOD in the window\n"
+              << "  --no-layer-cutoff    also draw the shells above the end of the fur\n"
+              << "  --shell-layers <n>   shells per object (default 64, up to 256)\n"
+              << "  --shell-spacing <s>  linear (default), root (denser near the root) or coverage (even steps of fur coverage)\n"
+              << "  --oit                weighted blended order-independent transparency for the shells, O toggles it\n"
+              << "  --alpha-to-coverage  opaque shells in a 4x MSAA target, alpha gives the covered samples, C toggles it\n"
+              << "  --compare-coverage   render the frames blended, then with alpha-to-coverage, and compare GPU times\n"
+              << "  --stencil-cull       stencil rejects shell pixels whose fur already ended at a lower shell, M toggles it\n"
+              << "  --shell-cache        capture the displaced shells of objects that don't move and draw them from there, K toggles it\n"
+              << "  --static-scene       the objects don't spin\n"
+              << "  --ray-march          one hull per object, the shader marches the ray through the fur layers, V toggles it\n"
+              << "  --ray-march-beyond <d> ray-march only objects at least d units from the camera, shells for the rest\n"
+              << "  --target-frame-ms <t> lower/raise quality at runtime to hold t ms of GPU time per frame\n"
+              << "  --shell-subset <n>   draw n rotating shells per frame and accumulate them over time, T toggles 16\n"
+              << "  --help               show this message" << std::endl;
+}
+
+// returns false if the program should exit (bad argument or --help).
+inline bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        // value of an option that takes an argument.
+        auto value = [&](const char* name) -> const char* {
+            if (i + 1 >= argc)
+            {
+                std::cout << "ERROR::OPTIONS:: " << name << " expects a value" << std::endl;
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        if (std::strcmp(arg, "--profile") == 0)
+            options.profile = true;
+        else if (std::strcmp(arg, "--trace") == 0)
+        {
+            const char* path = value(arg);
+            if (!path)
+                return false;
+            options.tracePath = path;
+            options.profile = true;
+        }
+        else if (std::strcmp(arg, "--headless") == 0)
+            options.headless = true;
+        else if (std::strcmp(arg, "--frames") == 0)
+        {
+            const char* count = value(arg);
+            if (!count)
+                return false;
+            options.frames = std::atoi(count);
+        }
+        else if (std::strcmp(arg, "--size") == 0)
+        {
+            const char* size = value(arg);
+            if (!size || std::sscanf(size, "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0)
+            {
+                std::cout << "ERROR::OPTIONS:: --size expects <width>x<height>" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--benchmark") == 0)
+            options.benchmark = true;
+        else if (std::strcmp(arg, "--benchmark-out") == 0)
+        {
+            const char* path = value(arg);
+            if (!path)
+                return false;
+            options.benchmarkPath = path;
+            options.benchmark = true;
+        }
+        else if (std::strcmp(arg, "--image-test") == 0)
+        {
+            const char* dir = value(arg);
+            if (!dir)
+                return false;
+            options.imageTestDir = dir;
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--image-test-out") == 0)
+        {
+            const char* dir = value(arg);
+            if (!dir)
+                return false;
+            options.imageTestOutput = dir;
+        }
+        else if (std::strcmp(arg, "--image-tolerance") == 0)
+        {
+            const char* tolerance = value(arg);
+            if (!tolerance)
+                return false;
+            options.imageTolerance = std::atof(tolerance);
+        }
+        else if (std::strcmp(arg, "--update-golden") == 0)
+            options.updateGolden = true;
+        else if (std::strcmp(arg, "--fur-scale") == 0)
+        {
+            const char* scale = value(arg);
+            if (!scale)
+                return false;
+            options.furScale = (float)std::atof(scale);
+            if (options.furScale <= 0.0f || options.furScale > 1.0f)
+            {
+                std::cout << "ERROR::OPTIONS:: --fur-scale expects a value in (0, 1]" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--objects") == 0)
+        {
+            const char* count = value(arg);
+            if (!count)
+                return false;
+            options.objects = std::atoi(count);
+            if (options.objects < 1 || options.objects > MAX_SCENE_OBJECTS)
+            {
+                std::cout << "ERROR::OPTIONS:: --objects expects 1 to " << MAX_SCENE_OBJECTS << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--fur-data") == 0)
+        {
+            const char* data = value(arg);
+            if (!data)
+                return false;
+            if (std::strcmp(data, "layers") == 0)
+                options.furData = FurData::Layers;
+            else if (std::strcmp(data, "volume") == 0)
+                options.furData = FurData::Volume;
+            else if (std::strcmp(data, "heights") == 0)
+                options.furData = FurData::Heights;
+            else
+            {
+                std::cout << "ERROR::OPTIONS:: --fur-data expects layers, volume or heights" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--sphere-geometry") == 0)
+        {
+            const char* geometry = value(arg);
+            if (!geometry)
+                return false;
+            if (std::strcmp(geometry, "attributes") == 0)
+                options.sphereGeometry = SphereGeometry::Attributes;
+            else if (std::strcmp(geometry, "procedural") == 0)
+                options.sphereGeometry = SphereGeometry::Procedural;
+            else if (std::strcmp(geometry, "pulled") == 0)
+                options.sphereGeometry = SphereGeometry::Pulled;
+            else
+            {
+                std::cout << "ERROR::OPTIONS:: --sphere-geometry expects attributes, procedural or pulled" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--shell-layers") == 0)
+        {
+            const char* count = value(arg);
+            if (!count)
+                return false;
+            options.shellLayers = std::atoi(count);
+            if (options.shellLayers < 2 || options.shellLayers > MAX_SHELL_LAYERS)
+            {
+                std::cout << "ERROR::OPTIONS:: --shell-layers expects 2 to " << MAX_SHELL_LAYERS << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--shell-spacing") == 0)
+        {
+            const char* spacing = value(arg);
+            if (!spacing)
+                return false;
+            if (std::strcmp(spacing, "linear") == 0)
+                options.shellSpacing = ShellSpacing::Linear;
+            else if (std::strcmp(spacing, "root") == 0)
+                options.shellSpacing = ShellSpacing::Root;
+            else if (std::strcmp(spacing, "coverage") == 0)
+                options.shellSpacing = ShellSpacing::Coverage;
+            else
+            {
+                std::cout << "ERROR::OPTIONS:: --shell-spacing expects linear, root or coverage" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--no-shell-lod") == 0)
+            options.shellLod = false;
+        else if (std::strcmp(arg, "--no-layer-cutoff") == 0)
+            options.layerCutoff = false;
+        else if (std::strcmp(arg, "--oit") == 0)
+            options.oit = true;
+        else if (std::strcmp(arg, "--stencil-cull") == 0)
+            options.stencilCull = true;
+        else if (std::strcmp(arg, "--shell-cache") == 0)
+            options.shellCache = true;
+        else if (std::strcmp(arg, "--static-scene") == 0)
+            options.staticScene = true;
+        else if (std::strcmp(arg, "--ray-march") == 0)
+            options.rayMarch = true;
+        else if (std::strcmp(arg, "--ray-march-beyond") == 0)
+        {
+            const char* distance = value(arg);
+            if (!distance)
+                return false;
+            options.rayMarchDistance = (float)std::atof(distance);
+            if (options.rayMarchDistance <= 0.0f)
+            {
+                std::cout << "ERROR::OPTIONS:: --ray-march-beyond expects a positive distance" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--alpha-to-coverage") == 0)
+            options.alphaToCoverage = true;
+        else if (std::strcmp(arg, "--compare-coverage") == 0)
+        {
+            options.compareCoverage = true;
+            options.headless = true;
+        }
+        else if (std::strcmp(arg, "--target-frame-ms") == 0)
+        {
+            const char* ms = value(arg);
+            if (!ms)
+                return false;
+            options.targetFrameMs = std::atof(ms);
+            if (options.targetFrameMs <= 0.0)
+            {
+                std::cout << "ERROR::OPTIONS:: --target-frame-ms expects a positive time" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--shell-subset") == 0)
+        {
+            const char* count = value(arg);
+            if (!count)
+                return false;
+            options.shellSubset = std::atoi(count);
+            if (options.shellSubset < 0)
+            {
+                std::cout << "ERROR::OPTIONS:: --shell-subset expects a shell count (0 draws all)" << std::endl;
+                return false;
+            }
+        }
+        else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            printUsage(argv[0]);
+            return false;
+        }
+        else
+        {
+            std::cout << "ERROR::OPTIONS:: unknown option " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (options.updateGolden && options.imageTestDir.empty())
+    {
+        std::cout << "ERROR::OPTIONS:: --update-golden needs --image-test <dir>" << std::endl;
+        return false;
+    }
+    if (options.compareCoverage && (options.furScale < 1.0f || options.shellSubset > 0))
+    {
+        std::cout << "ERROR::OPTIONS:: --compare-coverage needs full resolution shells without --shell-subset" << std::endl;
+        return false;
+    }
+    if (options.benchmark && options.frames <= 0)
+        options.frames = 500;
+    if (options.headless && options.frames <= 0)
+        options.frames = 300;
+    return true;
+}
+#endif
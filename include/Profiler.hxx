@@ -0,0 +1,458 @@
+#ifndef _PROFILER_HXX_
+#define _PROFILER_HXX_
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// CPU + GPU scope profiler.
+// Every scope records CPU time and a pair of GL_TIMESTAMP queries. Queries live in a ring of
+// FRAME_LATENCY frames and a frame is only read back when its ring slot comes around again; if the
+// results are still not available at that point they are dropped instead of waiting, so the
+// profiler never stalls the pipeline.
+class Profiler
+{
+public:
+    static const int FRAME_LATENCY = 4;     // frames between issuing a query and reading it back.
+    static const int MAX_SCOPES = 256;      // scopes per frame, the rest is ignored.
+    static const int SUMMARY_WINDOW = 120;  // samples in the rolling per-scope summary.
+    static const size_t MAX_TRACE_EVENTS = 2000000;
+
+    Profiler() : enabled(false), tracing(false), frameIndex(0), droppedFrames(0), depth(0), gpuOffsetUs(0.0), lastSummaryUs(0.0) {}
+
+    // delete the query objects, call while the context is still alive.
+    void release()
+    {
+        for (FrameSlot& slot : slots)
+        {
+            if (!slot.queries.empty())
+                glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+            slot.queries.clear();
+        }
+        enabled = false;
+    }
+
+    // needs a current GL context.
+    void init(bool trace)
+    {
+        enabled = true;
+        tracing = trace;
+        start = Clock::now();
+        for (FrameSlot& slot : slots)
+        {
+            slot.queries.resize(MAX_SCOPES * 2);
+            glGenQueries((GLsizei)slot.queries.size(), slot.queries.data());
+            slot.scopes.reserve(MAX_SCOPES);
+        }
+        // GPU timestamps are mapped onto the CPU time line through one synchronous sample.
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        gpuOffsetUs = cpuNowUs() - gpuNow / 1000.0;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    void beginFrame()
+    {
+        if (!enabled)
+            return;
+        FrameSlot& slot = slots[frameIndex % FRAME_LATENCY];
+        if (slot.pending)
+            collect(slot);
+        slot.scopes.clear();
+        slot.pending = false;
+        slot.lastQuery = 0;
+        depth = 0;
+    }
+
+    void endFrame()
+    {
+        if (!enabled)
+            return;
+        slots[frameIndex % FRAME_LATENCY].pending = true;
+        ++frameIndex;
+    }
+
+    // read back every frame still in flight, only meant for shutdown since it waits for the GPU.
+    void flush()
+    {
+        if (!enabled)
+            return;
+        glFinish();
+        for (int i = 0; i < FRAME_LATENCY; ++i)
+        {
+            FrameSlot& slot = slots[(frameIndex + i) % FRAME_LATENCY];
+            if (slot.pending)
+                collect(slot);
+            slot.scopes.clear();
+            slot.pending = false;
+            slot.lastQuery = 0;
+        }
+    }
+
+    // returns a handle for endScope, -1 if the scope is not recorded.
+    int beginScope(const std::string& name)
+    {
+        if (!enabled)
+            return -1;
+        FrameSlot& slot = slots[frameIndex % FRAME_LATENCY];
+        if ((int)slot.scopes.size() >= MAX_SCOPES)
+            return -1;
+        int handle = (int)slot.scopes.size();
+        slot.scopes.push_back(Scope());
+        Scope& scope = slot.scopes.back();
+        scope.name = name;
+        scope.depth = depth++;
+        scope.cpuBegin = cpuNowUs();
+        scope.cpuEnd = scope.cpuBegin;
+        slot.lastQuery = slot.queries[handle * 2];
+        glQueryCounter(slot.lastQuery, GL_TIMESTAMP);
+        return handle;
+    }
+
+    void endScope(int handle)
+    {
+        if (!enabled || handle < 0)
+            return;
+        FrameSlot& slot = slots[frameIndex % FRAME_LATENCY];
+        Scope& scope = slot.scopes[handle];
+        slot.lastQuery = slot.queries[handle * 2 + 1];
+        glQueryCounter(slot.lastQuery, GL_TIMESTAMP);
+        scope.cpuEnd = cpuNowUs();
+        --depth;
+    }
+
+    void printSummary() const
+    {
+        if (!enabled)
+            return;
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "profile (last " << SUMMARY_WINDOW << " frames, ms per frame avg/max, "
+                  << droppedFrames << " GPU frames dropped)" << std::endl;
+        std::cout << std::fixed << std::setprecision(3);
+        for (const std::string& name : order)
+        {
+            const Summary& s = summaries.at(name);
+            std::cout << "  " << std::string(s.depth * 2, ' ') << std::left << std::setw(24 - s.depth * 2) << name << std::right
+                      << "  cpu " << std::setw(8) << s.cpu.average() << " / " << std::setw(8) << s.cpu.maximum()
+                      << "  gpu " << std::setw(8) << s.gpu.average() << " / " << std::setw(8) << s.gpu.maximum()
+                      << "  calls " << std::setprecision(1) << std::setw(6) << s.calls.average() << std::setprecision(3) << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+    // print the summary if at least interval seconds passed since the last one.
+    void printSummaryEvery(double interval)
+    {
+        if (!enabled || order.empty())
+            return;
+        double now = cpuNowUs();
+        if (now - lastSummaryUs < interval * 1e6)
+            return;
+        lastSummaryUs = now;
+        printSummary();
+    }
+
+    // chrome://tracing and Perfetto read this format, CPU scopes are thread 1 and GPU scopes thread 2.
+    bool writeChromeTrace(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::PROFILER:: can't write trace " << path << std::endl;
+            return false;
+        }
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU render thread\"}},\n";
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+        file << std::fixed << std::setprecision(3);
+        for (const TraceEvent& e : events)
+        {
+            file << ",\n{\"name\":\"" << escape(e.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+                 << ",\"ts\":" << e.begin << ",\"dur\":" << e.duration << "}";
+        }
+        file << "\n]}\n";
+        std::cout << "profiler: wrote " << events.size() << " events to " << path << std::endl;
+        return true;
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Scope {
+        std::string name;
+        int depth;
+        double cpuBegin;
+        double cpuEnd;
+    };
+
+    struct FrameSlot {
+        std::vector<GLuint> queries;    // begin/end timestamp pair per scope.
+        std::vector<Scope> scopes;
+        GLuint lastQuery = 0;           // most recently issued query of the frame.
+        bool pending = false;
+    };
+
+    // fixed window of the latest samples.
+    struct Window {
+        float samples[SUMMARY_WINDOW] = {};
+        int count = 0;
+        int next = 0;
+
+        void add(float value)
+        {
+            samples[next] = value;
+            next = (next + 1) % SUMMARY_WINDOW;
+            if (count < SUMMARY_WINDOW)
+                ++count;
+        }
+        float average() const
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < count; ++i)
+                sum += samples[i];
+            return count ? sum / count : 0.0f;
+        }
+        float maximum() const
+        {
+            float m = 0.0f;
+            for (int i = 0; i < count; ++i)
+                m = std::max(m, samples[i]);
+            return m;
+        }
+    };
+
+    // a scope name can open several times per frame (per object, per batch), its samples are the
+    // per-frame sums of all of them.
+    struct Summary {
+        int depth = 0;
+        Window cpu;
+        Window gpu;
+        Window calls;
+        double frameCpu = 0.0;  // sums of the frame being collected, in milliseconds.
+        double frameGpu = 0.0;
+        int frameCalls = 0;
+    };
+
+    struct TraceEvent {
+        std::string name;
+        int thread;
+        double begin;       // microseconds since init.
+        double duration;
+    };
+
+    bool enabled;
+    bool tracing;
+    Clock::time_point start;
+    FrameSlot slots[FRAME_LATENCY];
+    unsigned long long frameIndex;
+    unsigned long long droppedFrames;
+    int depth;
+    double gpuOffsetUs;
+    double lastSummaryUs;
+    std::map<std::string, Summary> summaries;
+    std::vector<std::string> order;     // scope names in first-seen order for printing.
+    std::vector<TraceEvent> events;
+
+    double cpuNowUs() const
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+
+    // read back an old frame if the GPU is done with it, never waits.
+    void collect(FrameSlot& slot)
+    {
+        bool gpuReady = false;
+        if (slot.lastQuery)
+        {
+            // queries complete in order, the last one issued tells us about all of them.
+            GLint available = 0;
+            glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            gpuReady = available != 0;
+            if (!gpuReady)
+                ++droppedFrames;
+        }
+
+        std::vector<Summary*> seen;
+        for (size_t i = 0; i < slot.scopes.size(); ++i)
+        {
+            const Scope& scope = slot.scopes[i];
+            auto found = summaries.find(scope.name);
+            if (found == summaries.end())
+            {
+                found = summaries.emplace(scope.name, Summary()).first;
+                found->second.depth = scope.depth;
+                order.push_back(scope.name);
+            }
+            Summary& summary = found->second;
+            if (summary.frameCalls++ == 0)
+                seen.push_back(&summary);
+            summary.frameCpu += (scope.cpuEnd - scope.cpuBegin) / 1000.0;
+            if (tracing && events.size() < MAX_TRACE_EVENTS)
+                events.push_back({ scope.name, 1, scope.cpuBegin, scope.cpuEnd - scope.cpuBegin });
+
+            if (!gpuReady)
+                continue;
+            GLuint64 gpuBegin = 0, gpuEnd = 0;
+            glGetQueryObjectui64v(slot.queries[i * 2], GL_QUERY_RESULT, &gpuBegin);
+            glGetQueryObjectui64v(slot.queries[i * 2 + 1], GL_QUERY_RESULT, &gpuEnd);
+            double duration = (double)(gpuEnd - gpuBegin) / 1000.0;
+            summary.frameGpu += duration / 1000.0;
+            if (tracing && events.size() < MAX_TRACE_EVENTS)
+                events.push_back({ scope.name, 2, gpuBegin / 1000.0 + gpuOffsetUs, duration });
+        }
+
+        // one sample per name and frame.
+        for (Summary* summary : seen)
+        {
+            summary->cpu.add((float)summary->frameCpu);
+            if (gpuReady)
+                summary->gpu.add((float)summary->frameGpu);
+            summary->calls.add((float)summary->frameCalls);
+            summary->frameCpu = summary->frameGpu = 0.0;
+            summary->frameCalls = 0;
+        }
+    }
+
+    static std::string escape(const std::string& text)
+    {
+        std::string out;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+};
+
+// GPU time of whole frames from a pair of GL_TIMESTAMP queries per frame (unlike GL_TIME_ELAPSED
+// several timers can measure overlapping spans).
+// Same idea as the Profiler: a ring of queries, results are picked up when the ring comes around
+// and anything not finished by then is dropped, so it never waits for the GPU.
+class GpuFrameTimer
+{
+public:
+    static const int RING_SIZE = 8;
+
+    GpuFrameTimer() : next(0), active(false), keepAll(false), latestMs(-1.0), count(0) {}
+
+    // with keepEveryFrame a query that is still running when its slot is reused is waited for
+    // instead of dropped (benchmarks want every sample, the frame rate is not the point there).
+    void init(bool keepEveryFrame = false)
+    {
+        keepAll = keepEveryFrame;
+        glGenQueries(2 * RING_SIZE, &queries[0][0]);
+        for (int i = 0; i < RING_SIZE; ++i)
+            pending[i] = false;
+    }
+
+    void release()
+    {
+        glDeleteQueries(2 * RING_SIZE, &queries[0][0]);
+    }
+
+    void begin()
+    {
+        if (pending[next])
+            collect(next, keepAll);
+        glQueryCounter(queries[next][0], GL_TIMESTAMP);
+        active = true;
+    }
+
+    void end()
+    {
+        if (!active)
+            return;
+        glQueryCounter(queries[next][1], GL_TIMESTAMP);
+        pending[next] = true;
+        next = (next + 1) % RING_SIZE;
+        active = false;
+    }
+
+    // pick up every query still in flight, waits for the GPU.
+    void flush()
+    {
+        for (int i = 0; i < RING_SIZE; ++i)
+        {
+            int slot = (next + i) % RING_SIZE;
+            if (pending[slot])
+                collect(slot, true);
+        }
+    }
+
+    // GPU time of the most recently completed frame, negative if none completed yet.
+    double latest() const
+    {
+        return latestMs;
+    }
+
+    // number of frames measured so far, tells whether latest() is a new value.
+    unsigned long long sampleCount() const
+    {
+        return count;
+    }
+
+    // every completed frame time in milliseconds, in frame order (only kept with keepEveryFrame).
+    std::vector<double>& samples()
+    {
+        return completed;
+    }
+
+private:
+    GLuint queries[RING_SIZE][2];
+    bool pending[RING_SIZE];
+    int next;
+    bool active;
+    bool keepAll;
+    double latestMs;
+    unsigned long long count;
+    std::vector<double> completed;
+
+    void collect(int slot, bool wait)
+    {
+        GLint available = 0;
+        if (!wait)
+            glGetQueryObjectiv(queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (wait || available)
+        {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            latestMs = (end - begin) / 1.0e6;
+            ++count;
+            if (keepAll)
+                completed.push_back(latestMs);
+        }
+        pending[slot] = false;
+    }
+};
+
+// profiles the enclosing block.
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& profiler, const std::string& name) : profiler(profiler), handle(profiler.beginScope(name)) {}
+    ~ProfileScope()
+    {
+        profiler.endScope(handle);
+    }
+
+private:
+    Profiler& profiler;
+    int handle;
+};
+#endif
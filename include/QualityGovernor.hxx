@@ -0,0 +1,156 @@
+#ifndef _QUALITY_GOVERNOR_HXX_
+#define _QUALITY_GOVERNOR_HXX_
+
+#include <glad/glad.h>
+
+#include <FurRenderer.hxx>
+#include <Profiler.hxx>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// one step of the quality ladder, each is at most as expensive as the one before.
+struct QualityLevel {
+    int shellBudget;            // 0 is no limit.
+    float furScale;
+    float mipBias;
+};
+
+const QualityLevel QUALITY_LEVELS[] = {
+    {  0, 1.0f,  0.0f },
+    {  0, 1.0f,  1.0f },
+    { 32, 1.0f,  1.0f },
+    { 32, 0.5f,  1.0f },
+    { 16, 0.5f,  2.0f },
+    { 16, 0.25f, 2.0f },
+    {  8, 0.25f, 3.0f },
+};
+const int NUM_QUALITY_LEVELS = sizeof(QUALITY_LEVELS) / sizeof(QUALITY_LEVELS[0]);
+
+// Closed loop on the GPU frame time: when the smoothed time stays above the target the renderer
+// goes one level down the ladder, when it stays well below one level up. The dead band between
+// the two thresholds, the longer wait before going up and a settle time after every change keep
+// it from oscillating between two levels.
+class QualityGovernor
+{
+public:
+    static constexpr double OVER_TARGET = 1.05;     // degrade above target * OVER_TARGET.
+    static constexpr double UNDER_TARGET = 0.7;     // improve below target * UNDER_TARGET.
+    static constexpr double SMOOTHING = 0.2;        // weight of a new sample in the moving average.
+    static const int DEGRADE_SAMPLES = 10;
+    static const int IMPROVE_SAMPLES = 90;
+    // after a change the timer ring still holds frames rendered at the old level.
+    static const int SETTLE_SAMPLES = 2 * GpuFrameTimer::RING_SIZE;
+
+    QualityGovernor() : enabled(false), targetMs(0.0), level(0), smoothedMs(-1.0), seenSamples(0), over(0), under(0), settle(0) {}
+
+    // base is the quality the levels start from, a level never raises it.
+    void init(double frameMs, const RenderSettings& base)
+    {
+        enabled = true;
+        targetMs = frameMs;
+        baseSettings = base;
+        gpuTimer.init();
+        std::cout << "governor: holding " << targetMs << " ms GPU frame time, " << NUM_QUALITY_LEVELS << " quality levels" << std::endl;
+    }
+
+    void release()
+    {
+        if (enabled)
+            gpuTimer.release();
+        enabled = false;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    int currentLevel() const
+    {
+        return level;
+    }
+
+    void beginFrame()
+    {
+        if (enabled)
+            gpuTimer.begin();
+    }
+
+    // feed the newest GPU time into the controller and apply a level change to settings.
+    void endFrame(RenderSettings& settings)
+    {
+        if (!enabled)
+            return;
+        gpuTimer.end();
+        if (gpuTimer.sampleCount() == seenSamples)
+            return;
+        seenSamples = gpuTimer.sampleCount();
+
+        double sample = gpuTimer.latest();
+        smoothedMs = smoothedMs < 0.0 ? sample : smoothedMs + SMOOTHING * (sample - smoothedMs);
+        if (settle > 0)
+        {
+            --settle;
+            return;
+        }
+
+        if (smoothedMs > targetMs * OVER_TARGET)
+        {
+            ++over;
+            under = 0;
+        }
+        else if (smoothedMs < targetMs * UNDER_TARGET)
+        {
+            ++under;
+            over = 0;
+        }
+        else
+            over = under = 0;
+
+        if (over >= DEGRADE_SAMPLES && level + 1 < NUM_QUALITY_LEVELS)
+            change(level + 1, settings);
+        else if (under >= IMPROVE_SAMPLES && level > 0)
+            change(level - 1, settings);
+    }
+
+private:
+    bool enabled;
+    double targetMs;
+    RenderSettings baseSettings;
+    GpuFrameTimer gpuTimer;
+    int level;
+    double smoothedMs;
+    unsigned long long seenSamples;
+    int over;
+    int under;
+    int settle;
+
+    void change(int newLevel, RenderSettings& settings)
+    {
+        const QualityLevel& q = QUALITY_LEVELS[newLevel];
+        settings.shellBudget = baseSettings.shellBudget > 0 && q.shellBudget > 0 ? std::min(baseSettings.shellBudget, q.shellBudget)
+                                                                                 : std::max(baseSettings.shellBudget, q.shellBudget);
+        settings.furScale = std::min(baseSettings.furScale, q.furScale);
+        settings.mipBias = std::max(baseSettings.mipBias, q.mipBias);
+
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << std::fixed << std::setprecision(2)
+                  << "governor: gpu " << smoothedMs << " ms (target " << targetMs << "), quality level "
+                  << level << " -> " << newLevel << ": shell budget ";
+        if (settings.shellBudget > 0)
+            std::cout << settings.shellBudget;
+        else
+            std::cout << "all";
+        std::cout << ", fur scale " << settings.furScale << ", mip bias " << settings.mipBias << std::endl;
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+
+        level = newLevel;
+        over = under = 0;
+        settle = SETTLE_SAMPLES;
+    }
+};
+#endif
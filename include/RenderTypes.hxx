@@ -0,0 +1,48 @@
+#ifndef _RENDER_TYPES_HXX_
+#define _RENDER_TYPES_HXX_
+
+// choices of how the fur is rendered, shared by the options, the scene's fur parameters and the
+// renderer without pulling in either side.
+
+#define MAX_SHELL_LAYERS 256
+
+// how the shells of an object are spread over the fur length.
+enum class ShellSpacing {
+    Linear,     // evenly.
+    Root,       // quadratic, denser near the root where the fur is thick.
+    Coverage    // even steps of fur coverage, no shell where there is no fur left.
+};
+
+inline const char* shellSpacingName(ShellSpacing spacing)
+{
+    switch (spacing) {
+    case ShellSpacing::Root: return "root";
+    case ShellSpacing::Coverage: return "coverage";
+    default: return "linear";
+    }
+}
+
+// how the fur density is stored on the GPU, shared by all objects.
+enum class FurData {
+    Layers,     // NUM_FUR_TEXTURES 2D textures, one per band of shell heights.
+    Volume,     // one tileable 3D texture, height is the third coordinate.
+    Heights     // one 2D texture holding the height of the strand over each texel.
+};
+
+inline const char* furDataName(FurData data)
+{
+    return data == FurData::Volume ? "volume" : data == FurData::Heights ? "heights" : "layers";
+}
+
+// where the vertices of the fur sphere come from.
+enum class SphereGeometry {
+    Attributes,     // vertex and index buffers made by createSphere.
+    Procedural,     // no buffers, fur_shader.verx computes each vertex from its ids.
+    Pulled          // compact storage buffers of a VertexPool, fur_shader.verx reads and decodes them.
+};
+
+inline const char* sphereGeometryName(SphereGeometry geometry)
+{
+    return geometry == SphereGeometry::Procedural ? "procedural" : geometry == SphereGeometry::Pulled ? "pulled" : "attributes";
+}
+#endif
@@ -6,11 +6,25 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <thread>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile are not part of the generated loader.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+class ShaderBatch;
+
 class Shader
 {
+    friend class ShaderBatch;
 public:
     GLuint ID;
     // constructor generates the shader on the fly
@@ -153,39 +167,81 @@ public:
     {
       return ID;
     }
+    // uniform location, looked up once per name and then served from the cache.
+    // ------------------------------------------------------------------------
+    GLint getUniformLocation(const std::string &name) const
+    {
+        auto it = uniformLocations.find(name);
+        if (it != uniformLocations.end())
+            return it->second;
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        uniformLocations.emplace(name, location);
+        return location;
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(getUniformLocation(name), (int)value); 
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(getUniformLocation(name), value); 
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(getUniformLocation(name), value); 
     }
     
     void setVec3( const std::string& name, const glm::vec3& vec )
     {
-        glUniform3f( glGetUniformLocation( ID, name.c_str() ), vec.x, vec.y, vec.z );
+        glUniform3f( getUniformLocation( name ), vec.x, vec.y, vec.z );
     }
     
     void setVec4( const std::string& name, const glm::vec4& vec )
     {
-        glUniform4f( glGetUniformLocation( ID, name.c_str() ), vec.x, vec.y, vec.z, vec.w );
+        glUniform4f( getUniformLocation( name ), vec.x, vec.y, vec.z, vec.w );
     }
     
     void setMat4( const std::string& name, const glm::mat4& mat )
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // the first count elements of a vec2 array uniform.
+    void setVec2Array( const std::string& name, const glm::vec2* values, int count )
+    {
+        glUniform2fv(getUniformLocation(name), count, &values[0].x);
     }
 
 private:
+    mutable std::unordered_map<std::string, GLint> uniformLocations;
+
+    // wraps an already linked program (used by ShaderBatch).
+    explicit Shader(GLuint programID) : ID(programID) {}
+
+    // reads the whole file into a string, returns empty string on failure.
+    static std::string readSource(const char* path)
+    {
+        std::ifstream file;
+        file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            file.open(path);
+            std::stringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            return stream.str();
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << path << " " << e.what() << std::endl;
+        }
+        return std::string();
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
@@ -212,4 +268,233 @@ private:
         }
     }
 };
+
+// Compiles several programs at once: every compile and link is submitted first and the status
+// queries are deferred to finish(), so a driver with parallel compilation can work on all of them
+// (and on anything the application does between submit() and finish()) at the same time.
+class ShaderBatch
+{
+public:
+    struct Timing
+    {
+        std::string name;
+        double submitMs;   // time spent in glCompileShader/glLinkProgram calls.
+        double readyMs;    // time from the end of submission until the program was reported complete.
+        bool success;
+    };
+
+    void add(const std::string& name, const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr,
+             const char* tcsPath = nullptr, const char* tesPath = nullptr)
+    {
+        Entry entry;
+        entry.name = name;
+        entry.paths[0] = vertexPath;
+        entry.paths[1] = fragmentPath;
+        entry.paths[2] = geometryPath ? geometryPath : "";
+        entry.paths[3] = (tcsPath && tesPath) ? tcsPath : "";
+        entry.paths[4] = (tcsPath && tesPath) ? tesPath : "";
+        entries.push_back(entry);
+    }
+
+    // same as add(), defines (e.g. "#define TEMPORAL\n") are inserted after the #version line of every stage.
+    void addVariant(const std::string& name, const std::string& defines, const char* vertexPath, const char* fragmentPath,
+                    const char* geometryPath = nullptr, const char* tcsPath = nullptr, const char* tesPath = nullptr)
+    {
+        add(name, vertexPath, fragmentPath, geometryPath, tcsPath, tesPath);
+        entries.back().defines = defines;
+    }
+
+    // vertex-only program whose outputs named in varyings are written interleaved to transform feedback buffer 0.
+    void addCapture(const std::string& name, const std::string& defines, const char* vertexPath, const std::vector<std::string>& varyings)
+    {
+        add(name, vertexPath, "");
+        entries.back().defines = defines;
+        entries.back().varyings = varyings;
+    }
+
+    // issue all compiles and links without querying any status.
+    void submit()
+    {
+        static const GLenum stages[5] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER,
+                                          GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER };
+        parallel = hasParallelCompile();
+        for (Entry& entry : entries)
+        {
+            // file reading is kept out of the measured submission time.
+            std::string sources[5];
+            for (int stage = 0; stage < 5; ++stage)
+                if (!entry.paths[stage].empty())
+                    sources[stage] = withDefines(Shader::readSource(entry.paths[stage].c_str()), entry.defines);
+
+            auto start = Clock::now();
+            entry.program = glCreateProgram();
+            for (int stage = 0; stage < 5; ++stage)
+            {
+                if (entry.paths[stage].empty())
+                    continue;
+                const char* code = sources[stage].c_str();
+                GLuint shader = glCreateShader(stages[stage]);
+                glShaderSource(shader, 1, &code, NULL);
+                glCompileShader(shader);
+                glAttachShader(entry.program, shader);
+                entry.shaders.push_back(shader);
+            }
+            if (!entry.varyings.empty())
+            {
+                std::vector<const char*> names;
+                for (const std::string& varying : entry.varyings)
+                    names.push_back(varying.c_str());
+                glTransformFeedbackVaryings(entry.program, (GLsizei)names.size(), names.data(), GL_INTERLEAVED_ATTRIBS);
+            }
+            glLinkProgram(entry.program);
+            entry.submitMs = msSince(start);
+        }
+        submitted = Clock::now();
+    }
+
+    // wait for every program, check the results and return them in the order they were added.
+    std::vector<Shader> finish()
+    {
+        std::vector<Shader> programs;
+        std::vector<bool> done(entries.size(), false);
+        size_t remaining = entries.size();
+        while (remaining > 0)
+        {
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                if (done[i])
+                    continue;
+                GLint complete = GL_TRUE;
+                if (parallel)
+                {
+                    glGetProgramiv(entries[i].program, GL_COMPLETION_STATUS_KHR, &complete);
+                }
+                else
+                {
+                    // without the extension the link status query blocks until the link is done,
+                    // the programs become ready one after the other in the order they were added.
+                    GLint linked;
+                    glGetProgramiv(entries[i].program, GL_LINK_STATUS, &linked);
+                }
+                if (complete)
+                {
+                    entries[i].readyMs = msSince(submitted);
+                    done[i] = true;
+                    --remaining;
+                }
+            }
+            if (remaining > 0)
+                std::this_thread::yield();
+        }
+        totalMs = msSince(submitted);
+
+        timings.clear();
+        for (Entry& entry : entries)
+        {
+            GLint linked;
+            glGetProgramiv(entry.program, GL_LINK_STATUS, &linked);
+            if (!linked)
+            {
+                // only look at the individual stages when something went wrong.
+                static const char* stageNames[5] = { "VERTEX", "FRAGMENT", "GEOMETRY", "TESS_CONTROL_SHADER", "TESS_EVALUATION_SHADER" };
+                Shader program(entry.program);
+                size_t next = 0;
+                for (int stage = 0; stage < 5; ++stage)
+                    if (!entry.paths[stage].empty())
+                        program.checkCompileErrors(entry.shaders[next++], stageNames[stage]);
+                program.checkCompileErrors(entry.program, "PROGRAM");
+            }
+            for (GLuint shader : entry.shaders)
+            {
+                glDetachShader(entry.program, shader);
+                glDeleteShader(shader);
+            }
+            entry.shaders.clear();
+            timings.push_back({ entry.name, entry.submitMs, entry.readyMs, linked == GL_TRUE });
+            programs.push_back(Shader(entry.program));
+        }
+        entries.clear();
+        return programs;
+    }
+
+    std::vector<Shader> compile()
+    {
+        submit();
+        return finish();
+    }
+
+    const std::vector<Timing>& getTimings() const
+    {
+        return timings;
+    }
+
+    void printReport() const
+    {
+        std::ios::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+        std::cout << "shader batch: " << timings.size() << " program(s), "
+                  << (parallel ? "parallel" : "serial") << " compile, "
+                  << std::fixed << std::setprecision(2) << totalMs << " ms until all ready" << std::endl;
+        for (const Timing& t : timings)
+        {
+            std::cout << "  " << std::left << std::setw(20) << t.name << std::right
+                      << " submit " << std::setw(8) << t.submitMs << " ms"
+                      << "  ready after " << std::setw(8) << t.readyMs << " ms"
+                      << (t.success ? "" : "  FAILED") << std::endl;
+        }
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        std::string name;
+        std::string paths[5];
+        std::string defines;
+        std::vector<std::string> varyings;
+        GLuint program = 0;
+        std::vector<GLuint> shaders;
+        double submitMs = 0.0;
+        double readyMs = 0.0;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<Timing> timings;
+    Clock::time_point submitted;
+    double totalMs = 0.0;
+    bool parallel = false;
+
+    static double msSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // #version has to stay the first line, the defines go right after it.
+    static std::string withDefines(const std::string& source, const std::string& defines)
+    {
+        if (defines.empty())
+            return source;
+        size_t lineEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') : std::string::npos;
+        if (lineEnd == std::string::npos)
+            return defines + source;
+        return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+    }
+
+    static bool hasParallelCompile()
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; ++i)
+        {
+            const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            if (name && (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0 ||
+                         std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+                return true;
+        }
+        return false;
+    }
+};
 #endif
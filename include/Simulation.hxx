@@ -0,0 +1,302 @@
+#ifndef _SIMULATION_HXX_
+#define _SIMULATION_HXX_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <Camera.hxx>
+#include <RenderTypes.hxx>
+#include <TripleBuffer.hxx>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#define MAX_SCENE_OBJECTS 16
+
+// fur parameters of a single object.
+struct FurParams {
+    float length;
+    int shellLayers;
+    glm::vec3 color;
+    ShellSpacing spacing = ShellSpacing::Linear;
+};
+
+struct ObjectState {
+    glm::mat4 model;
+    FurParams fur;
+};
+
+// immutable state of one simulated frame, everything the renderer needs to draw it.
+struct FrameSnapshot {
+    unsigned long long tick;    // number of simulation steps taken.
+    double time;                // simulation time in seconds.
+    glm::mat4 view;
+    glm::vec3 cameraPosition;
+    float zoom;
+    int objectCount;
+    std::array<ObjectState, MAX_SCENE_OBJECTS> objects;
+};
+
+// input written by the window thread and consumed by the simulation thread.
+struct InputState {
+    std::atomic<unsigned int> keys{0};      // bit (1 << Camera_Movement) is set while the key is held.
+    std::atomic<uint64_t> cursor{0};        // x and y as two packed floats, published together.
+    std::atomic<bool> cursorValid{false};
+    std::atomic<float> scroll{0.0f};        // accumulated until the next simulation step.
+
+    void addScroll(float offset)
+    {
+        float current = scroll.load();
+        while (!scroll.compare_exchange_weak(current, current + offset))
+            ;
+    }
+
+    void setCursor(float x, float y)
+    {
+        uint32_t bits[2];
+        std::memcpy(&bits[0], &x, sizeof(float));
+        std::memcpy(&bits[1], &y, sizeof(float));
+        cursor.store((uint64_t)bits[0] | ((uint64_t)bits[1] << 32), std::memory_order_relaxed);
+        cursorValid.store(true, std::memory_order_release);
+    }
+
+    // x and y always come from the same cursor event.
+    void getCursor(float& x, float& y) const
+    {
+        uint64_t packed = cursor.load(std::memory_order_relaxed);
+        uint32_t bits[2] = { (uint32_t)packed, (uint32_t)(packed >> 32) };
+        std::memcpy(&x, &bits[0], sizeof(float));
+        std::memcpy(&y, &bits[1], sizeof(float));
+    }
+};
+
+// where object index sits in a multi-object scene: the first one at the origin, the others on a
+// sunflower spiral around it, so their distances to the camera range from close-up to far away.
+inline glm::vec3 sceneObjectPosition(int index)
+{
+    if (index == 0)
+        return glm::vec3(0.0f);
+    float angle = index * 2.39996323f;      // golden angle.
+    float radius = 2.5f * sqrtf((float)index);
+    return glm::vec3(radius * sinf(angle), 0.0f, -radius * cosf(angle));
+}
+
+// deterministic camera path of the benchmark: one slow orbit around the origin that starts close to
+// the fur on the lit side (worst case fill rate), moves out behind the object and comes back,
+// repeating every 20 seconds of simulation time.
+inline glm::vec3 scriptedCameraPosition(double time)
+{
+    const double PERIOD = 20.0;
+    double phase = time / PERIOD * 2.0 * 3.14159265358979;
+    float radius = 2.4f - 0.7f * (float)cos(phase);
+    float height = 0.8f * (float)sin(phase * 2.0);
+    return glm::vec3(radius * (float)sin(phase), height, radius * (float)cos(phase));
+}
+
+// scene update with a fixed time step, independent of the rendering frame rate.
+class Simulation
+{
+public:
+    static constexpr float FIXED_DT = 1.0f / 120.0f;
+
+    Camera camera;
+
+    Simulation(const FurParams& fur) : camera(glm::vec3(0.0f, 0.0f, 3.0f)), time(0.0), tick(0), rotationSpeed(0.3f), scripted(false), firstMouse(true), lastX(0.0f), lastY(0.0f)
+    {
+        objectCount = 1;
+        objects[0].model = glm::mat4(1.0f);
+        objects[0].fur = fur;
+        positions[0] = glm::vec3(0.0f);
+    }
+
+    // fill the scene with count copies of the first object (different tint each) at sceneObjectPosition().
+    void setObjectCount(int count)
+    {
+        objectCount = glm::clamp(count, 1, MAX_SCENE_OBJECTS);
+        for (int i = 1; i < objectCount; ++i)
+        {
+            positions[i] = sceneObjectPosition(i);
+            objects[i].fur = objects[0].fur;
+            float tint = (float)i / MAX_SCENE_OBJECTS;
+            objects[i].fur.color = objects[0].fur.color * glm::vec3(1.0f - 0.4f * tint, 1.0f, 0.7f + 0.6f * tint);
+        }
+        updateModels();
+    }
+
+    // the objects stop spinning and keep their model matrices from now on.
+    void setStatic(bool enable)
+    {
+        rotationSpeed = enable ? 0.0f : 0.3f;
+        updateModels();
+    }
+
+    // the camera follows scriptedCameraPosition() instead of the input.
+    void setScriptedCamera(bool enable)
+    {
+        scripted = enable;
+    }
+
+    // advance the scene by dt seconds, input may be null when there is no window.
+    void step(float dt, InputState* input)
+    {
+        if (input && !scripted)
+            applyInput(dt, *input);
+
+        time += dt;
+        ++tick;
+        if (scripted)
+        {
+            camera.Position = scriptedCameraPosition(time);
+            camera.LookAt(glm::vec3(0.0f));
+        }
+        updateModels();
+    }
+
+    void writeSnapshot(FrameSnapshot& snapshot)
+    {
+        snapshot.tick = tick;
+        snapshot.time = time;
+        snapshot.view = camera.GetViewMatrix();
+        snapshot.cameraPosition = camera.Position;
+        snapshot.zoom = camera.Zoom;
+        snapshot.objectCount = objectCount;
+        for (int i = 0; i < objectCount; ++i)
+            snapshot.objects[i] = objects[i];
+    }
+
+private:
+    double time;
+    unsigned long long tick;
+    float rotationSpeed;
+    bool scripted;
+    int objectCount;
+    std::array<ObjectState, MAX_SCENE_OBJECTS> objects;
+    std::array<glm::vec3, MAX_SCENE_OBJECTS> positions;
+
+    // every object spins around its own vertical axis.
+    void updateModels()
+    {
+        glm::mat4 spin = glm::rotate(glm::mat4(1.0f), (float)time * rotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f));
+        for (int i = 0; i < objectCount; ++i)
+            objects[i].model = glm::translate(glm::mat4(1.0f), positions[i]) * spin;
+    }
+
+    // mouse state, offsets are computed here from the absolute cursor position.
+    bool firstMouse;
+    float lastX;
+    float lastY;
+
+    void applyInput(float dt, InputState& input)
+    {
+        unsigned int keys = input.keys.load(std::memory_order_relaxed);
+        if (keys & (1u << FORWARD))
+            camera.ProcessKeyboard(FORWARD, dt);
+        if (keys & (1u << BACKWARD))
+            camera.ProcessKeyboard(BACKWARD, dt);
+        if (keys & (1u << LEFT))
+            camera.ProcessKeyboard(LEFT, dt);
+        if (keys & (1u << RIGHT))
+            camera.ProcessKeyboard(RIGHT, dt);
+
+        if (input.cursorValid.load(std::memory_order_acquire))
+        {
+            float xpos, ypos;
+            input.getCursor(xpos, ypos);
+            if (firstMouse)
+            {
+                lastX = xpos;
+                lastY = ypos;
+                firstMouse = false;
+            }
+            float xoffset = xpos - lastX;
+            float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+            lastX = xpos;
+            lastY = ypos;
+            if (xoffset != 0.0f || yoffset != 0.0f)
+                camera.ProcessMouseMovement(xoffset, yoffset);
+        }
+
+        float scroll = input.scroll.exchange(0.0f);
+        if (scroll != 0.0f)
+            camera.ProcessMouseScroll(scroll);
+    }
+};
+
+// runs a Simulation on its own thread and publishes a snapshot after every batch of fixed steps.
+class SimulationThread
+{
+public:
+    SimulationThread(Simulation& simulation, InputState& input, TripleBuffer<FrameSnapshot>& frames)
+        : simulation(simulation), input(input), frames(frames), running(false) {}
+
+    ~SimulationThread()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        // the renderer must have a valid snapshot before the first frame.
+        simulation.writeSnapshot(frames.writeBuffer());
+        frames.publish();
+
+        running = true;
+        worker = std::thread(&SimulationThread::run, this);
+    }
+
+    void stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+    // upper bound of steps per update, so a stall doesn't turn into an endless catch-up.
+    static const int MAX_STEPS = 8;
+
+    Simulation& simulation;
+    InputState& input;
+    TripleBuffer<FrameSnapshot>& frames;
+    std::atomic<bool> running;
+    std::thread worker;
+
+    void run()
+    {
+        double accumulator = 0.0;
+        Clock::time_point previous = Clock::now();
+        while (running)
+        {
+            Clock::time_point now = Clock::now();
+            accumulator += std::chrono::duration<double>(now - previous).count();
+            previous = now;
+
+            int steps = 0;
+            while (accumulator >= Simulation::FIXED_DT && steps < MAX_STEPS)
+            {
+                simulation.step(Simulation::FIXED_DT, &input);
+                accumulator -= Simulation::FIXED_DT;
+                ++steps;
+            }
+            if (steps == MAX_STEPS)
+                accumulator = 0.0;
+
+            if (steps > 0)
+            {
+                simulation.writeSnapshot(frames.writeBuffer());
+                frames.publish();
+            }
+
+            // sleep until the next step is due.
+            std::chrono::duration<double> wait(Simulation::FIXED_DT - accumulator);
+            std::this_thread::sleep_until(now + std::chrono::duration_cast<Clock::duration>(wait));
+        }
+    }
+};
+#endif
@@ -0,0 +1,53 @@
+#ifndef _TRIPLE_BUFFER_HXX_
+#define _TRIPLE_BUFFER_HXX_
+
+#include <atomic>
+
+// Lock-free triple buffer for one producer thread and one consumer thread.
+// The producer owns a back slot, the consumer owns a front slot and the third (middle) slot is
+// exchanged atomically between them, so neither side ever waits and the consumer always gets the
+// newest value that was completely written.
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    // producer: slot to fill before calling publish().
+    T& writeBuffer()
+    {
+        return slots[back];
+    }
+
+    // producer: hand the filled slot over, take the middle one as the next back slot.
+    void publish()
+    {
+        back = middle.exchange(back | DIRTY_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // consumer: grab the newest published slot, returns false if nothing new was published.
+    bool update()
+    {
+        if (!(middle.load(std::memory_order_acquire) & DIRTY_BIT))
+            return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // consumer: the slot obtained by the last update(), stays valid until the next update().
+    const T& read() const
+    {
+        return slots[front];
+    }
+
+private:
+    static const unsigned char INDEX_MASK = 3;
+    static const unsigned char DIRTY_BIT  = 4;
+
+    T slots[3];
+    // separate cache lines so the two threads don't fight over the indices they own.
+    alignas(64) std::atomic<unsigned char> middle;
+    alignas(64) unsigned char back;
+    alignas(64) unsigned char front;
+};
+#endif
@@ -0,0 +1,71 @@
+#ifndef _UPLOAD_RING_HXX_
+#define _UPLOAD_RING_HXX_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// Ring of pixel unpack buffers to stream texture data in pieces. A piece is written into the next
+// buffer and the glTexSubImage2D calls after end() read from there, so the driver copies it into
+// the texture while the CPU already prepares the next piece. A buffer is written again only
+// RING_SIZE pieces later, and its old storage is orphaned when it is mapped.
+class UploadRing
+{
+public:
+    static const int RING_SIZE = 3;
+
+    UploadRing() : capacity(0), next(0)
+    {
+        for (GLuint& buffer : buffers)
+            buffer = 0;
+    }
+
+    // bytes is the size of the largest piece.
+    void init(size_t bytes)
+    {
+        capacity = bytes;
+        next = 0;
+        glGenBuffers(RING_SIZE, buffers);
+        for (GLuint buffer : buffers) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    // binds and maps the next buffer, the piece is written at the returned address.
+    unsigned char* begin()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[next]);
+        next = (next + 1) % RING_SIZE;
+        return static_cast<unsigned char*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, capacity,
+                                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+    }
+
+    // unmaps the piece. The buffer stays bound, uploads until the next begin() take offsets into it.
+    void end()
+    {
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+
+    // pixel pointer argument of glTexSubImage2D for bytes into the current piece.
+    static const void* offset(size_t bytes)
+    {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(bytes));
+    }
+
+    // unbinds the ring, uploads from client memory work again.
+    void release()
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glDeleteBuffers(RING_SIZE, buffers);
+        for (GLuint& buffer : buffers)
+            buffer = 0;
+    }
+
+private:
+    GLuint buffers[RING_SIZE];
+    size_t capacity;
+    int next;
+};
+#endif
@@ -0,0 +1,223 @@
+#ifndef _VERTEX_POOL_HXX_
+#define _VERTEX_POOL_HXX_
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// one mesh inside a VertexPool, drawn as the slot-th instance range over its indices:
+// gl_VertexID walks from firstIndex and the vertex shader adds the mesh's base vertex to each.
+struct PooledMesh {
+    GLint firstIndex = 0;
+    GLsizei indexCount = 0;
+    GLint baseVertex = 0;
+    GLuint slot = 0;        // row of the pool's mesh table, the base instance of its draws.
+};
+
+// Vertices and indices of many meshes in two shader storage buffers that the vertex shader reads
+// itself (vertex pulling), no vertex attribute pointers and no VAO per mesh. A vertex is 20 bytes
+// instead of 32: the position stays three floats, the normal is octahedral-encoded into two snorm16
+// and the uv is two unorm16 over the uv range of its mesh, so tiled uvs outside [0, 1] keep working.
+// Indices are 16-bit and relative to the mesh's base vertex, two to a uint.
+// What differs per mesh (base vertex, uv offset and scale) is a table read through two instanced
+// attributes: a draw's base instance picks its mesh's row, so meshes switch without touching the VAO
+// or a uniform. fur_shader.verx (VERTEX_PULLING) has the matching decoder.
+class VertexPool
+{
+public:
+    static const GLuint VERTEX_BINDING = 0;
+    static const GLuint INDEX_BINDING = 1;
+    static const GLuint BASE_VERTEX_ATTRIBUTE = 3;
+    static const GLuint TEX_COORD_RANGE_ATTRIBUTE = 4;
+    static const size_t MAX_MESH_VERTICES = 65536;    // what 16-bit indices reach.
+    static const GLint STORAGE_BLOCKS = 2;             // vertices and indices, both read by the vertex shader.
+
+    VertexPool() : vertexBuffer(0), indexBuffer(0), meshBuffer(0), bytes(0) {}
+
+    // true if the vertex shader can read the pool, GL 4.3 only guarantees storage blocks in compute
+    // and fragment shaders.
+    static bool supported()
+    {
+        GLint blocks = 0;
+        glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &blocks);
+        return blocks >= STORAGE_BLOCKS;
+    }
+
+    // append a mesh in the 8-float layout of createSphere (position, normal, uv) before upload().
+    // Callers keep to MAX_MESH_VERTICES, a larger mesh is refused and comes back empty.
+    PooledMesh add(const std::vector<float>& vertices, const std::vector<unsigned int>& indices)
+    {
+        size_t count = vertices.size() / 8;
+        if (count > MAX_MESH_VERTICES)
+        {
+            std::cout << "ERROR::VERTEX_POOL:: mesh of " << count << " vertices doesn't fit 16-bit indices" << std::endl;
+            return PooledMesh();
+        }
+        PooledMesh mesh;
+        mesh.firstIndex = (GLint)pooledIndices.size();
+        mesh.indexCount = (GLsizei)indices.size();
+        mesh.baseVertex = (GLint)pooledVertices.size();
+        mesh.slot = (GLuint)meshes.size();
+
+        // uvs are stored relative to the mesh's uv bounds.
+        MeshRecord record = { mesh.baseVertex, { 0.0f, 0.0f }, { 0.0f, 0.0f } };
+        for (int c = 0; c < 2; ++c)
+        {
+            float low = count ? vertices[6 + c] : 0.0f, high = low;
+            for (size_t v = 1; v < count; ++v)
+            {
+                low = std::min(low, vertices[v * 8 + 6 + c]);
+                high = std::max(high, vertices[v * 8 + 6 + c]);
+            }
+            record.texCoordOffset[c] = low;
+            record.texCoordScale[c] = high - low;
+        }
+        meshes.push_back(record);
+
+        for (size_t v = 0; v < count; ++v)
+        {
+            const float* source = &vertices[v * 8];
+            PackedVertex packed;
+            packed.position[0] = source[0];
+            packed.position[1] = source[1];
+            packed.position[2] = source[2];
+            packed.normal = packNormal(source[3], source[4], source[5]);
+            packed.texCoord = packTexCoord(source[6], record, 0) | packTexCoord(source[7], record, 1) << 16;
+            pooledVertices.push_back(packed);
+        }
+        for (unsigned int index : indices)
+            pooledIndices.push_back((uint16_t)index);
+        return mesh;
+    }
+
+    // copy everything added so far into the storage buffers, the CPU copies are dropped.
+    void upload()
+    {
+        // the shader reads whole uints, an odd index count gets a padding half.
+        if (pooledIndices.size() % 2)
+            pooledIndices.push_back(0);
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, vertexBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, pooledVertices.size() * sizeof(PackedVertex), pooledVertices.data(), GL_STATIC_DRAW);
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, indexBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, pooledIndices.size() * sizeof(uint16_t), pooledIndices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glGenBuffers(1, &meshBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+        glBufferData(GL_ARRAY_BUFFER, meshes.size() * sizeof(MeshRecord), meshes.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        bytes = pooledVertices.size() * sizeof(PackedVertex) + pooledIndices.size() * sizeof(uint16_t) +
+                meshes.size() * sizeof(MeshRecord);
+        pooledVertices = std::vector<PackedVertex>();
+        pooledIndices = std::vector<uint16_t>();
+        meshes = std::vector<MeshRecord>();
+    }
+
+    // the indexed bindings are context state, they stay put for every program that pulls.
+    void bind() const
+    {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VERTEX_BINDING, vertexBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, indexBuffer);
+    }
+
+    // vao reads the mesh table through the per-instance attributes, the only ones it has. Leaves vao bound.
+    void attach(GLuint vao) const
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, meshBuffer);
+        glEnableVertexAttribArray(BASE_VERTEX_ATTRIBUTE);
+        glVertexAttribIPointer(BASE_VERTEX_ATTRIBUTE, 1, GL_INT, sizeof(MeshRecord), (void*)offsetof(MeshRecord, baseVertex));
+        glVertexAttribDivisor(BASE_VERTEX_ATTRIBUTE, 1);
+        glEnableVertexAttribArray(TEX_COORD_RANGE_ATTRIBUTE);
+        glVertexAttribPointer(TEX_COORD_RANGE_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, sizeof(MeshRecord), (void*)offsetof(MeshRecord, texCoordOffset));
+        glVertexAttribDivisor(TEX_COORD_RANGE_ATTRIBUTE, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // one mesh with the current program and a VAO set up by attach().
+    static void draw(const PooledMesh& mesh)
+    {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, mesh.firstIndex, mesh.indexCount, 1, mesh.slot);
+    }
+
+    // size of both buffers after upload().
+    size_t size() const
+    {
+        return bytes;
+    }
+
+    void release()
+    {
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        glDeleteBuffers(1, &meshBuffer);
+        vertexBuffer = indexBuffer = meshBuffer = 0;
+        bytes = 0;
+    }
+
+private:
+    // std430 layout of PackedVertex in fur_shader.verx.
+    struct PackedVertex {
+        float position[3];
+        uint32_t normal;
+        uint32_t texCoord;
+    };
+
+    // a row of the mesh table, the layout of the instanced attributes.
+    struct MeshRecord {
+        GLint baseVertex;
+        float texCoordOffset[2];
+        float texCoordScale[2];
+    };
+
+    GLuint vertexBuffer;
+    GLuint indexBuffer;
+    GLuint meshBuffer;
+    size_t bytes;
+    std::vector<PackedVertex> pooledVertices;
+    std::vector<uint16_t> pooledIndices;
+    std::vector<MeshRecord> meshes;
+
+    static uint32_t packUnorm16(float value)
+    {
+        return (uint32_t)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f);
+    }
+
+    // component c of a uv as a unorm16 over the mesh's uv range.
+    static uint32_t packTexCoord(float value, const MeshRecord& mesh, int c)
+    {
+        float scale = mesh.texCoordScale[c];
+        return scale > 0.0f ? packUnorm16((value - mesh.texCoordOffset[c]) / scale) : 0;
+    }
+
+    static uint32_t packSnorm16(float value)
+    {
+        return (uint32_t)(uint16_t)(int16_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+    }
+
+    // octahedral encoding: the unit sphere folded onto the square [-1, 1]², the lower half mirrored
+    // over the diagonals.
+    static uint32_t packNormal(float x, float y, float z)
+    {
+        float length = std::fabs(x) + std::fabs(y) + std::fabs(z);
+        if (length == 0.0f)
+            return 0;
+        float u = x / length;
+        float v = y / length;
+        if (z < 0.0f)
+        {
+            float foldedU = (1.0f - std::fabs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+            float foldedV = (1.0f - std::fabs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+            u = foldedU;
+            v = foldedV;
+        }
+        return packSnorm16(u) | packSnorm16(v) << 16;
+    }
+};
+#endif
@@ -0,0 +1,19 @@
+#version 430 core
+out vec4 FragColor;
+
+uniform sampler2D accumulation;  // сумма взвешенных premultiplied цветов слоев и их весов
+uniform sampler2D revealage;     // произведение (1 - alpha) всех слоев
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float reveal = texelFetch(revealage, pixel, 0).r;
+    // Ни один слой не попал в пиксель
+    if (reveal >= 1.0)
+        discard;
+
+    // Средний цвет слоев, покрытие берется из revealage, смешивание поверх основы
+    vec4 accum = texelFetch(accumulation, pixel, 0);
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    FragColor = vec4(average, 1.0 - reveal);
+}
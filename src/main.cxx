@@ -8,7 +8,18 @@
 #include <Shader.hxx>
 #include <Camera.hxx>
 #include <Model.hxx>
-
+#include <Simulation.hxx>
+#include <TripleBuffer.hxx>
+#include <Options.hxx>
+#include <Profiler.hxx>
+#include <Framebuffer.hxx>
+#include <Headless.hxx>
+#include <FurRenderer.hxx>
+#include <Benchmark.hxx>
+#include <ImageTest.hxx>
+#include <QualityGovernor.hxx>
+
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <cmath>
@@ -16,141 +27,37 @@
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
+int runWindowed(const Options& options);
+int runHeadless(const Options& options);
+BenchmarkInfo benchmarkInfo(const char* mode, int width, int height, const RenderSettings& settings, const Options& options);
+RenderSettings settingsFrom(const Options& options);
+void finishRun(const char* mode, int width, int height, FurRenderer& renderer, Profiler& profiler,
+               Benchmark& benchmark, QualityGovernor& governor, const Options& options);
+FurParams sceneFur(const Options& options);
+void compareCoverage(FurRenderer& renderer, const Framebuffer& target, const Options& options);
+void renderHeadlessFrames(FurRenderer& renderer, Profiler& profiler, const Framebuffer& target, Benchmark& benchmark,
+                          QualityGovernor& governor, const Options& options);
+
+// input shared with the simulation thread, camera and scene live in the Simulation.
+InputState input;
+
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options))
+        return 1;
 
-// settings
-const unsigned int SCR_WIDTH = 800;
-const unsigned int SCR_HEIGHT = 600;
-
-// camera
-Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-float lastX = SCR_WIDTH / 2.0f;
-float lastY = SCR_HEIGHT / 2.0f;
-bool firstMouse = true;
-
-// timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-
-// generation of simple fur texture.
-GLuint generateFurTexture(int width, int height, float dotSize) {
-    srand(0);
-    std::vector<unsigned char> data(width * height, 0);
-    
-    // count of dots.
-    int numDots = (width * height) / 10;
-    
-    for (int i = 0; i < numDots; ++i) {
-        int centerX = rand() % width;
-        int centerY = rand() % height;
-        
-        // size of point with some variations.
-        float currentDotSize = dotSize * (0.8f + 0.4f * (rand() % 100) / 100.0f);
-        int radius = static_cast<int>(currentDotSize * std::min(width, height) / 2);
-        
-        // Draw round dot.
-        for (int dy = -radius; dy <= radius; ++dy) {
-            for (int dx = -radius; dx <= radius; ++dx) {
-                if (dx*dx + dy*dy <= radius*radius) {
-                    int px = (centerX + dx + width) % width;
-                    int py = (centerY + dy + height) % height;
-                    
-                    // Smooth fade to the edges.
-                    float dist = sqrtf(dx*dx + dy*dy) / radius;
-                    float value = 1.0f - dist * dist;
-                    
-                    value *= 1.0f - (float)py / height * 0.5f;
-                    
-		    // mixing with existing values.
-                    float oldValue = data[py * width + px] / 255.0f;
-                    value = std::max(oldValue, value);
-                    data[py * width + px] = static_cast<unsigned char>(value * 255);
-                }
-            }
-        }
-    }
-    
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, data.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    
-    return textureID;
-}
+    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
+    stbi_set_flip_vertically_on_load(true);
 
-// create simple sphere for demonstration.
-void createSphere(std::vector<float>& vertices, std::vector<unsigned int>& indices, 
-                 float radius = 1.0f, int sectors = 36, int stacks = 18) {
-    const float PI = 3.1415926f;
-    
-    float x, y, z, xy;
-    float nx, ny, nz, lengthInv = 1.0f / radius;
-    float s, t;
-    
-    float sectorStep = 2 * PI / sectors;
-    float stackStep = PI / stacks;
-    float sectorAngle, stackAngle;
-    
-    for(int i = 0; i <= stacks; ++i) {
-        stackAngle = PI / 2 - i * stackStep;
-        xy = radius * cosf(stackAngle);
-        z = radius * sinf(stackAngle);
-        
-        for(int j = 0; j <= sectors; ++j) {
-            sectorAngle = j * sectorStep;
-            
-            // position of vertex.
-            x = xy * cosf(sectorAngle);
-            y = xy * sinf(sectorAngle);
-            
-            // normal.
-            nx = x * lengthInv;
-            ny = y * lengthInv;
-            nz = z * lengthInv;
-            
-            // texture coords.
-            s = (float)j / sectors;
-            t = (float)i / stacks;
-            
-            // add the vertex.
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-            vertices.push_back(nx);
-            vertices.push_back(ny);
-            vertices.push_back(nz);
-            vertices.push_back(s);
-            vertices.push_back(t);
-        }
-    }
-    
-    // indexes generation.
-    for(int i = 0; i < stacks; ++i) {
-        int k1 = i * (sectors + 1);
-        int k2 = k1 + sectors + 1;
-        
-        for(int j = 0; j < sectors; ++j, ++k1, ++k2) {
-            if(i != 0) {
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
-            }
-            
-            if(i != (stacks - 1)) {
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
-            }
-        }
-    }
+    if (options.headless)
+        return runHeadless(options);
+    return runWindowed(options);
 }
 
-int main() {
+int runWindowed(const Options& options) {
     // glfw: initialize and configure.
     // ------------------------------
     glfwInit();
@@ -164,7 +71,7 @@ int main() {
 
     // glfw window creation.
     // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    GLFWwindow* window = glfwCreateWindow(options.width, options.height, "LearnOpenGL", NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -187,141 +94,285 @@ int main() {
         return -1;
     }
 
-    // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
-    stbi_set_flip_vertically_on_load(true);
-
-
-
-    // setting OpenGL
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    Profiler profiler;
+    if (options.profile)
+        profiler.init(!options.tracePath.empty());
+    FurRenderer renderer(profiler);
+    // the settings decide which programs init compiles.
+    renderer.settings = settingsFrom(options);
+    renderer.init(options.furData, options.sphereGeometry);
+    // quality toggles are handled in the key callback, it reaches the renderer through the window.
+    glfwSetWindowUserPointer(window, &renderer);
+    glfwSetKeyCallback(window, key_callback);
     
-    // create fur texture.
-    const int NUM_FUR_TEXTURES = 5;
-    GLuint* furTextures = new GLuint[NUM_FUR_TEXTURES];
-
-    // sizes of dots for each of textures.
-    float dotSizes[NUM_FUR_TEXTURES] = {0.002f, 0.001f, 0.0005f, 0.00025f, 0.000125f};
-
-    for (int i = 0; i < NUM_FUR_TEXTURES; ++i) {
-        furTextures[i] = generateFurTexture(2048, 2048, dotSizes[i]);
+    // simulation runs on its own thread with a fixed time step and hands frames over through a triple buffer.
+    Simulation simulation(sceneFur(options));
+    simulation.setObjectCount(options.objects);
+    simulation.setStatic(options.staticScene);
+    TripleBuffer<FrameSnapshot> frames;
+    SimulationThread simulationThread(simulation, input, frames);
+
+    // benchmark: scripted camera, one fixed step per frame and no vsync, so the numbers only depend on build and hardware.
+    Benchmark benchmark;
+    FrameSnapshot scriptedFrame;
+    if (options.benchmark) {
+        glfwSwapInterval(0);
+        simulation.setScriptedCamera(true);
+        benchmark.init();
     }
-
-    Shader shader("fur_shader.verx", "fur_shader.frag");
-    
-    // Sphere creation
-    std::vector<float> sphereVertices;
-    std::vector<unsigned int> sphereIndices;
-    createSphere(sphereVertices, sphereIndices);
-    
-    GLuint VAO, VBO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    
-    glBindVertexArray(VAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
-    
-    // positions.
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // normals.
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // texture coords.
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    
-    glBindVertexArray(0);
-    
-    // rendering params.
-    const int SHELL_LAYERS = 64;
-    const float FUR_LENGTH = 0.3f;
+    else
+        simulationThread.start();
+    QualityGovernor governor;
+    if (options.targetFrameMs > 0.0)
+        governor.init(options.targetFrameMs, renderer.settings);
     
+    int frameCount = 0;
+    int width = options.width, height = options.height;
     while (!glfwWindowShouldClose(window)) {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
         // input
         // -----
         processInput(window);
 
-        // render
-        // ------
-        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // don't forget to enable shader before setting uniforms
-        shader.use();
-        
-        glm::mat4 model = glm::mat4(1.0f);
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 300.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        model = glm::rotate(model, (float)glfwGetTime() * 0.3f, glm::vec3(0.0f, 1.0f, 0.0f));
-        
-        // illumination
-        glm::vec3 lightPos(5.0f, 5.0f, 5.0f);
-        glm::vec3 viewPos(3.0f, 3.0f, 3.0f);
-        glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
-        glm::vec3 objectColor(0.8f, 0.7f, 0.3f); // fur color.
-        
-        
-        
-        shader.setMat4("view", view);
-        shader.setMat4("projection", projection);
-        shader.setVec3("lightPos", lightPos);
-        shader.setVec3("viewPos", viewPos);
-        shader.setVec3("lightColor", lightColor);
-        shader.setVec3("objectColor", objectColor);
-        shader.setFloat("furLength", FUR_LENGTH);
-        
-        // texture binding.
-        glActiveTexture(GL_TEXTURE0);
-        
-        for (int i = 0; i < NUM_FUR_TEXTURES; ++i) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            glBindTexture(GL_TEXTURE_2D, furTextures[i]);
-            shader.setInt(("furTextures[" + std::to_string(i) + "]").c_str(), i);
+        // take the newest simulated frame, the previous one is reused if nothing new arrived.
+        const FrameSnapshot* frame;
+        if (options.benchmark) {
+            simulation.step(Simulation::FIXED_DT, nullptr);
+            simulation.writeSnapshot(scriptedFrame);
+            frame = &scriptedFrame;
+        }
+        else {
+            frames.update();
+            frame = &frames.read();
         }
 
-        // rendering all layers (shell-texturing).
-        glBindVertexArray(VAO);
-        for (int i = 0; i < SHELL_LAYERS; ++i) {
-            float shellHeight = (float)i / SHELL_LAYERS;
-            shader.setFloat("shellHeight", shellHeight);
-            shader.setMat4("model", model);
-            
-            glDrawElements(GL_TRIANGLES, sphereIndices.size(), GL_UNSIGNED_INT, 0);
+        // render
+        // ------
+        glfwGetFramebufferSize(window, &width, &height);
+        if (width > 0 && height > 0) {
+            benchmark.beginFrame();
+            governor.beginFrame();
+            renderer.render(*frame, 0, width, height);
+            governor.endFrame(renderer.settings);
+            benchmark.endFrame();
         }
-        glBindVertexArray(0);
         
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        profiler.printSummaryEvery(2.0);
+        if (options.frames > 0 && ++frameCount >= options.frames)
+            glfwSetWindowShouldClose(window, true);
     }
     
     // clear.
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    for (int i = 0; i < NUM_FUR_TEXTURES; ++i) {
-      glDeleteTextures(1, &furTextures[i]);
-    }
-    delete [] furTextures;
-    
+    simulationThread.stop();
+    finishRun("windowed", width, height, renderer, profiler, benchmark, governor, options);
     glfwTerminate();
     return 0;
 }
 
+// render without a window: EGL context, offscreen framebuffer and a simulation stepped once per frame.
+int runHeadless(const Options& options) {
+#ifdef FUR_HAS_EGL
+    HeadlessContext context;
+    if (!context.create(4, 3))
+        return -1;
+    if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        context.release();
+        return -1;
+    }
+    std::cout << "renderer: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+
+    Framebuffer target;
+    if (!target.create(options.width, options.height))
+    {
+        context.release();
+        return -1;
+    }
+
+    Profiler profiler;
+    if (options.profile)
+        profiler.init(!options.tracePath.empty());
+    FurRenderer renderer(profiler);
+    // the settings decide which programs init compiles.
+    renderer.settings = settingsFrom(options);
+    renderer.init(options.furData, options.sphereGeometry);
+
+    // every headless mode ends with the same teardown, the benchmark and governor stay off outside the frame loop.
+    Benchmark benchmark;
+    QualityGovernor governor;
+    int result = 0;
+    if (!options.imageTestDir.empty())
+        result = runImageTests(renderer, sceneFur(options), options.imageTestDir, options.imageTestOutput,
+                               options.updateGolden, options.imageTolerance) == 0 ? 0 : 1;
+    else if (options.compareCoverage)
+        compareCoverage(renderer, target, options);
+    else
+        renderHeadlessFrames(renderer, profiler, target, benchmark, governor, options);
+
+    finishRun("headless", target.width, target.height, renderer, profiler, benchmark, governor, options);
+    target.release();
+    context.release();
+    return result;
+#else
+    std::cout << "ERROR::HEADLESS:: this build has no EGL support" << std::endl;
+    return -1;
+#endif
+}
+
+// the --frames frames of a headless run into target.
+void renderHeadlessFrames(FurRenderer& renderer, Profiler& profiler, const Framebuffer& target, Benchmark& benchmark,
+                          QualityGovernor& governor, const Options& options)
+{
+    // no input and no wall clock: every frame advances the scene by exactly one fixed step.
+    Simulation simulation(sceneFur(options));
+    simulation.setObjectCount(options.objects);
+    simulation.setStatic(options.staticScene);
+    FrameSnapshot frame;
+    if (options.benchmark) {
+        simulation.setScriptedCamera(true);
+        benchmark.init();
+    }
+    if (options.targetFrameMs > 0.0)
+        governor.init(options.targetFrameMs, renderer.settings);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.frames; ++i) {
+        simulation.step(Simulation::FIXED_DT, nullptr);
+        simulation.writeSnapshot(frame);
+        benchmark.beginFrame();
+        governor.beginFrame();
+        renderer.render(frame, target.FBO, target.width, target.height);
+        governor.endFrame(renderer.settings);
+        benchmark.endFrame();
+        profiler.printSummaryEvery(2.0);
+    }
+    glFinish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "headless: " << options.frames << " frames at " << target.width << "x" << target.height
+              << " in " << seconds << " s (" << seconds * 1000.0 / options.frames << " ms/frame)" << std::endl;
+}
+
+// settings recorded next to the benchmark timings.
+BenchmarkInfo benchmarkInfo(const char* mode, int width, int height, const RenderSettings& settings, const Options& options)
+{
+    BenchmarkInfo info;
+    info.mode = mode;
+    info.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    info.version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+    info.width = width;
+    info.height = height;
+    info.shellLayers = options.shellLayers;
+    info.shellSpacing = shellSpacingName(options.shellSpacing);
+    info.furLength = FUR_LENGTH;
+    info.furData = furDataName(options.furData);
+    info.sphereGeometry = sphereGeometryName(options.sphereGeometry);
+    info.textureCount = NUM_FUR_TEXTURES;
+    info.textureSize = FUR_TEXTURE_SIZE;
+    for (int i = 0; i < NUM_FUR_TEXTURES; ++i)
+        info.textureSizes.push_back(furTextureSize(FUR_DOT_SIZES[i]));
+    info.dotSizes.assign(FUR_DOT_SIZES, FUR_DOT_SIZES + NUM_FUR_TEXTURES);
+    info.furScale = settings.furScale;
+    info.shellSubset = settings.shellSubset;
+    info.shellLod = settings.shellLod;
+    info.layerCutoff = settings.layerCutoff;
+    info.oit = settings.oit;
+    info.alphaToCoverage = settings.alphaToCoverage;
+    info.stencilCull = settings.stencilCull;
+    info.shellCache = settings.shellCache;
+    info.staticScene = options.staticScene;
+    info.rayMarch = settings.rayMarch;
+    info.rayMarchDistance = settings.rayMarchDistance;
+    info.objects = options.objects;
+    info.shellBudget = settings.shellBudget;
+    info.mipBias = settings.mipBias;
+    return info;
+}
+
+// quality settings the renderer starts with.
+RenderSettings settingsFrom(const Options& options)
+{
+    RenderSettings settings;
+    settings.furScale = options.furScale;
+    settings.shellSubset = options.shellSubset;
+    settings.shellLod = options.shellLod;
+    settings.layerCutoff = options.layerCutoff;
+    settings.oit = options.oit;
+    settings.alphaToCoverage = options.alphaToCoverage;
+    settings.stencilCull = options.stencilCull;
+    settings.shellCache = options.shellCache;
+    settings.rayMarch = options.rayMarch;
+    settings.rayMarchDistance = options.rayMarchDistance;
+    return settings;
+}
+
+// end of every run that has a renderer: benchmark report (if it was enabled), trace and
+// statistics, then the profiler's and renderer's GL resources while the context still exists.
+void finishRun(const char* mode, int width, int height, FurRenderer& renderer, Profiler& profiler,
+               Benchmark& benchmark, QualityGovernor& governor, const Options& options)
+{
+    BenchmarkInfo info = benchmarkInfo(mode, width, height, renderer.settings, options);
+    info.sphereGeometry = sphereGeometryName(renderer.geometry());
+    benchmark.finish(info, options.benchmarkPath);
+    benchmark.release();
+    governor.release();
+    profiler.flush();
+    if (!options.tracePath.empty())
+        profiler.writeChromeTrace(options.tracePath);
+    if (options.profile)
+        renderer.printStateStats();
+    if (renderer.settings.shellCache)
+        renderer.printShellCacheStats();
+    profiler.release();
+    renderer.release();
+}
+
+// fur of every object in the scene.
+FurParams sceneFur(const Options& options)
+{
+    return FurParams{FUR_LENGTH, options.shellLayers, glm::vec3(0.8f, 0.7f, 0.3f), options.shellSpacing};
+}
+
+// the same scripted frames once with blended shells and once with alpha-to-coverage, GPU time of both.
+void compareCoverage(FurRenderer& renderer, const Framebuffer& target, const Options& options)
+{
+    double meanMs[2];
+    for (int pass = 0; pass < 2; ++pass) {
+        renderer.settings.alphaToCoverage = pass == 1;
+        Simulation simulation(sceneFur(options));
+        simulation.setObjectCount(options.objects);
+        simulation.setScriptedCamera(true);
+        FrameSnapshot frame;
+        GpuFrameTimer gpuTimer;
+        gpuTimer.init(true);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < options.frames; ++i) {
+            simulation.step(Simulation::FIXED_DT, nullptr);
+            simulation.writeSnapshot(frame);
+            gpuTimer.begin();
+            renderer.render(frame, target.FBO, target.width, target.height);
+            gpuTimer.end();
+        }
+        glFinish();
+        double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / options.frames;
+        gpuTimer.flush();
+        std::vector<double>& samples = gpuTimer.samples();
+        if ((int)samples.size() > Benchmark::WARMUP_FRAMES)
+            samples.erase(samples.begin(), samples.begin() + Benchmark::WARMUP_FRAMES);
+        FrameTimeStats gpu = computeFrameTimeStats(samples);
+        meanMs[pass] = gpu.mean;
+        std::cout << "coverage comparison: " << (pass ? "alpha-to-coverage" : "blended          ") << " gpu mean "
+                  << gpu.mean << " ms, p50 " << gpu.p50 << " ms, p95 " << gpu.p95 << " ms, wall " << wallMs << " ms/frame" << std::endl;
+        gpuTimer.release();
+    }
+    renderer.settings.alphaToCoverage = options.alphaToCoverage;
+    if (meanMs[1] > 0.0)
+        std::cout << "coverage comparison: " << options.frames << " frames at " << target.width << "x" << target.height
+                  << ", alpha-to-coverage is " << meanMs[0] / meanMs[1] << "x the speed of blending" << std::endl;
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
@@ -329,14 +380,17 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    // only the key state is sampled here, the simulation thread moves the camera.
+    unsigned int keys = 0;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, deltaTime);
+        keys |= 1u << FORWARD;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, deltaTime);
+        keys |= 1u << BACKWARD;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, deltaTime);
+        keys |= 1u << LEFT;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, deltaTime);
+        keys |= 1u << RIGHT;
+    input.keys.store(keys, std::memory_order_relaxed);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -345,35 +399,70 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    // once the renderer exists it owns the viewport, otherwise its state cache would skip the next
+    // viewport call with the old size as redundant.
+    FurRenderer* renderer = static_cast<FurRenderer*>(glfwGetWindowUserPointer(window));
+    if (renderer)
+        renderer->resizeViewport(width, height);
+    else
+        glViewport(0, 0, width, height);
 }
 
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
-    float xpos = static_cast<float>(xposIn);
-    float ypos = static_cast<float>(yposIn);
-
-    if (firstMouse)
-    {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
-    }
-
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-    lastX = xpos;
-    lastY = ypos;
-
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    input.setCursor(static_cast<float>(xposIn), static_cast<float>(yposIn));
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    input.addScroll(static_cast<float>(yoffset));
+}
+
+// glfw: single key presses toggle render settings (held keys are polled in processInput)
+// ---------------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int /*scancode*/, int action, int /*mods*/)
+{
+    if (action != GLFW_PRESS)
+        return;
+    FurRenderer* renderer = static_cast<FurRenderer*>(glfwGetWindowUserPointer(window));
+    if (!renderer)
+        return;
+    if (key == GLFW_KEY_R) {
+        renderer->cycleFurScale();
+        std::cout << "fur scale: " << renderer->settings.furScale << std::endl;
+    }
+    else if (key == GLFW_KEY_L) {
+        renderer->toggleShellLod();
+        std::cout << "shell LOD: " << (renderer->settings.shellLod ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_T) {
+        renderer->toggleShellSubset();
+        std::cout << "shell subset: " << (renderer->settings.shellSubset > 0 ? std::to_string(renderer->settings.shellSubset) : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_C) {
+        renderer->toggleAlphaToCoverage();
+        std::cout << "alpha-to-coverage: " << (renderer->settings.alphaToCoverage ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_M) {
+        renderer->toggleStencilCull();
+        std::cout << "stencil culling: " << (renderer->settings.stencilCull ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_K) {
+        renderer->toggleShellCache();
+        std::string blocker = renderer->shellCacheBlocker();
+        std::cout << "shell cache: " << (renderer->settings.shellCache ? "on" : "off")
+                  << (blocker.empty() ? "" : ", not used with " + blocker) << std::endl;
+    }
+    else if (key == GLFW_KEY_V) {
+        renderer->toggleRayMarch();
+        std::cout << "ray-marched fur: " << (renderer->settings.rayMarch ? "on" : "off") << std::endl;
+    }
+    else if (key == GLFW_KEY_O) {
+        renderer->toggleOit();
+        std::cout << "order-independent transparency: " << (renderer->settings.oit ? "on" : "off") << std::endl;
+    }
 }
@@ -0,0 +1,38 @@
+#version 430 core
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D currentColor;  // текущий кадр (с джиттером и неполным набором слоев)
+uniform sampler2D velocityMap;   // смещение относительно предыдущего кадра
+uniform sampler2D historyColor;  // накопленный результат предыдущих кадров
+uniform float feedback;          // вес истории, 0 - истории нет
+
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(currentColor, 0));
+    vec3 current = texture(currentColor, TexCoord).rgb;
+
+    // Диапазон цветов соседей 3x3, история за его пределами считается устаревшей
+    vec3 low = current;
+    vec3 high = current;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec3 neighbour = texture(currentColor, TexCoord + vec2(x, y) * texel).rgb;
+            low = min(low, neighbour);
+            high = max(high, neighbour);
+        }
+    }
+
+    vec2 previous = TexCoord - texture(velocityMap, TexCoord).xy;
+    if (feedback <= 0.0 || any(lessThan(previous, vec2(0.0))) || any(greaterThan(previous, vec2(1.0))))
+    {
+        FragColor = vec4(current, 1.0);
+        return;
+    }
+
+    vec3 history = clamp(texture(historyColor, previous).rgb, low, high);
+    FragColor = vec4(mix(current, history, feedback), 1.0);
+}
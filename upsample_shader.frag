@@ -0,0 +1,53 @@
+#version 430 core
+in vec2 TexCoord;
+
+out vec4 FragColor;
+
+uniform sampler2D furColor;    // мех в уменьшенном разрешении, premultiplied alpha
+uniform sampler2D furDepth;    // глубина базовой сферы в уменьшенном разрешении
+uniform sampler2D sceneDepth;  // глубина базовой сферы в полном разрешении
+uniform float nearPlane;
+uniform float farPlane;
+
+// Чувствительность к разнице глубин (относительной)
+const float DEPTH_SHARPNESS = 64.0;
+
+float linearDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * nearPlane * farPlane / (farPlane + nearPlane - z * (farPlane - nearPlane));
+}
+
+void main()
+{
+    // Четыре соседних texel'а, как у билинейной фильтрации
+    ivec2 lowSize = textureSize(furColor, 0);
+    vec2 pos = TexCoord * vec2(lowSize) - 0.5;
+    ivec2 base = ivec2(floor(pos));
+    vec2 f = pos - vec2(base);
+
+    float center = linearDepth(texture(sceneDepth, TexCoord).r);
+
+    vec4 sum = vec4(0.0);
+    vec4 bilinear = vec4(0.0);
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + offset, ivec2(0), lowSize - 1);
+        float w = (offset.x == 1 ? f.x : 1.0 - f.x) * (offset.y == 1 ? f.y : 1.0 - f.y);
+
+        // Texel'ы с другой глубиной (другой объект или фон) почти не учитываются
+        float depth = linearDepth(texelFetch(furDepth, texel, 0).r);
+        float difference = abs(depth - center) / center;
+        float weight = w * exp(-difference * difference * DEPTH_SHARPNESS * DEPTH_SHARPNESS);
+
+        vec4 color = texelFetch(furColor, texel, 0);
+        sum += color * weight;
+        weightSum += weight;
+        bilinear += color * w;
+    }
+
+    // Если ни один texel не подходит по глубине, берём обычную билинейную интерполяцию
+    FragColor = weightSum > 1e-4 ? sum / weightSum : bilinear;
+}